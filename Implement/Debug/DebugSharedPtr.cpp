@@ -14,5 +14,224 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <SharedPtr/SharedDebug.hpp>
+
 bool DebugSharedPtr = false;
 
+#ifdef DEBUG_SPTR_COUNT
+
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <cxxabi.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include <Platform/PlatformHeader.hpp>
+
+/* Open addressing table of the backtraces, never resized.
+ * The ones not fitting in it are counted in the last slot. */
+#define SPTR_SITE_CNT 4096
+#define SPTR_SITE_DEPTH 8
+
+struct CSharedPtrRefSite
+{
+	void *mFrames[SPTR_SITE_DEPTH];
+	uint32_t mDepth;
+	uint32_t mUsed;
+	uint64_t mAddRef;
+	uint64_t mReleaseRef;
+};
+
+static CSharedPtrRefSite sRefSites[SPTR_SITE_CNT + 1];
+
+static CSharedPtrRefSite *GetRefSite(void **frames, uint32_t depth)
+{
+	uint32_t idx = depth;
+
+	for (uint32_t i = 0; i < depth; ++i) {
+		idx = (idx ^ (uint32_t)((uintptr_t)frames[i] >> 2)) * 2654435761U;
+	}
+
+	for (uint32_t i = 0; i < SPTR_SITE_CNT; ++i) {
+		CSharedPtrRefSite *slot = &sRefSites[(idx + i) % SPTR_SITE_CNT];
+
+		/* 0: free, 1: being filled, 2: used */
+		if (0 == ATOMIC_LOAD_EXPLICIT(&slot->mUsed, ATOMIC_ACQUIRE) &&
+			ATOMIC_COMPARE_AND_SWAP(&slot->mUsed, 0, 1)) {
+			memcpy(slot->mFrames, frames, depth * sizeof(void *));
+			slot->mDepth = depth;
+			/* Publish the frames and the depth */
+			ATOMIC_STORE_EXPLICIT(&slot->mUsed, 2, ATOMIC_RELEASE);
+			return slot;
+		}
+
+		while (1 == ATOMIC_LOAD_EXPLICIT(&slot->mUsed, ATOMIC_ACQUIRE)) {
+			/* Being filled by another thread */
+		}
+
+		if (slot->mDepth == depth &&
+			0 == memcmp(slot->mFrames, frames, depth * sizeof(void *))) {
+			return slot;
+		}
+	}
+
+	return &sRefSites[SPTR_SITE_CNT];
+}
+
+void SharedPtrCountRef(bool add)
+{
+	void *frames[SPTR_SITE_DEPTH + 1];
+	int depth = backtrace(frames, SPTR_SITE_DEPTH + 1);
+
+	/* frames[0] is this function */
+	CSharedPtrRefSite *slot = GetRefSite(frames + 1, depth > 1 ? depth - 1 : 0);
+
+	ATOMIC_ADD_AND_FETCH(add ? &slot->mAddRef : &slot->mReleaseRef, 1);
+}
+
+/* Whether name is a member of the CSharedPtr classes */
+static bool IsSharedPtrFrame(const char *name)
+{
+	static const char *classes[] = {
+		"CSharedPtr<", "CSharedBase<", "CWeakPtr<",
+		"CEnableSharedPtr<", "CLocalSharedPtr<",
+	};
+	const char *end = strchr(name, '(');
+
+	for (const char *cls : classes) {
+		for (const char *p = strstr(name, cls);
+			 nullptr != p && (nullptr == end || p < end);
+			 p = strstr(p + 1, cls)) {
+			if (p != name && ' ' != p[-1]) {
+				continue;
+			}
+
+			/* Skip the template parameters */
+			const char *q = p + strlen(cls);
+
+			for (int depth = 1; '\0' != *q && 0 != depth; ++q) {
+				depth += ('<' == *q) ? 1 : ('>' == *q) ? -1 : 0;
+			}
+
+			if (0 == strncmp(q, "::", 2)) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+struct CSharedPtrRefCaller
+{
+	std::string mName;
+	uint64_t mAddRef;
+	uint64_t mReleaseRef;
+};
+
+void SharedPtrShowRefCount(uint32_t top)
+{
+	std::map<void *, CSharedPtrRefCaller> callers;
+	std::vector<CSharedPtrRefCaller> sorted;
+	uint64_t addRef = 0;
+	uint64_t releaseRef = 0;
+
+	/* The backtraces are merged by their first frame out
+	 * of the CSharedPtr classes: the call site. */
+	for (uint32_t i = 0; i <= SPTR_SITE_CNT; ++i) {
+		const CSharedPtrRefSite &site = sRefSites[i];
+		void *frame = nullptr;
+		std::string name("?");
+
+		if (0 == site.mAddRef && 0 == site.mReleaseRef) {
+			continue;
+		}
+
+		for (uint32_t j = 0; j < site.mDepth; ++j) {
+			Dl_info info = {};
+			char *demangled;
+			int status;
+
+			/* A local symbol: the offset in the module for addr2line */
+			if (0 == dladdr(site.mFrames[j], &info) || nullptr == info.dli_sname) {
+				char addr[32];
+
+				snprintf(addr, sizeof(addr), "+0x%lx",
+						 (unsigned long)((char *)site.mFrames[j] - (char *)info.dli_fbase));
+				name = (nullptr != info.dli_fname) ? info.dli_fname : "?";
+				name += addr;
+				frame = site.mFrames[j];
+				break;
+			}
+
+			demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+			name = (nullptr != demangled) ? demangled : info.dli_sname;
+			free(demangled);
+
+			if (!IsSharedPtrFrame(name.c_str())) {
+				char offset[32];
+
+				snprintf(offset, sizeof(offset), "+0x%lx",
+						 (unsigned long)((char *)site.mFrames[j] - (char *)info.dli_saddr));
+				name += offset;
+				frame = site.mFrames[j];
+				break;
+			}
+		}
+
+		/* Only the CSharedPtr classes in the backtrace */
+		if (nullptr == frame) {
+			name += " ...";
+		}
+
+		CSharedPtrRefCaller &caller = callers[frame];
+
+		caller.mName = name;
+		caller.mAddRef += site.mAddRef;
+		caller.mReleaseRef += site.mReleaseRef;
+	}
+
+	for (auto &it : callers) {
+		sorted.push_back(it.second);
+	}
+
+	std::sort(sorted.begin(), sorted.end(),
+			  [](const CSharedPtrRefCaller &a, const CSharedPtrRefCaller &b) {
+		return a.mAddRef + a.mReleaseRef > b.mAddRef + b.mReleaseRef;
+	});
+
+	SharedPtrGetRefCount(addRef, releaseRef);
+	printf("CSharedPtr AddRef: %lu ReleaseRef: %lu Sites: %lu\n",
+		   (unsigned long)addRef, (unsigned long)releaseRef,
+		   (unsigned long)sorted.size());
+
+	for (uint32_t i = 0; i < top && i < sorted.size(); ++i) {
+		printf("%10lu %10lu  %s\n",
+			   (unsigned long)sorted[i].mAddRef,
+			   (unsigned long)sorted[i].mReleaseRef,
+			   sorted[i].mName.c_str());
+	}
+}
+
+void SharedPtrResetRefCount(void)
+{
+	for (uint32_t i = 0; i <= SPTR_SITE_CNT; ++i) {
+		sRefSites[i].mAddRef = 0;
+		sRefSites[i].mReleaseRef = 0;
+	}
+}
+
+void SharedPtrGetRefCount(uint64_t &addRef, uint64_t &releaseRef)
+{
+	addRef = 0;
+	releaseRef = 0;
+
+	for (uint32_t i = 0; i <= SPTR_SITE_CNT; ++i) {
+		addRef += sRefSites[i].mAddRef;
+		releaseRef += sRefSites[i].mReleaseRef;
+	}
+}
+
+#endif /* DEBUG_SPTR_COUNT */
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Pool/PoolReport.hpp>
+
+CJsonPtr CPoolReport::ToJson(void)
+{
+	CJsonPtr root(nullptr, nullptr);
+	CJsonPtr pools(CConstStringPtr("pools"), nullptr);
+
+	root->AddChild(pools);
+
+	CPoolTelemetry<>::ForEach([&](const CPoolUsage &usage) {
+		pools->AddChild(ToJson(usage));
+	});
+
+	return root;
+}
+
+CJsonPtr CPoolReport::ToJson(const CPoolUsage &usage)
+{
+	CJsonPtr pool(nullptr, nullptr, CJson::ARRAY);
+
+	pool->AddChild(CConstStringPtr("block"), DEC(usage.mBlockSize));
+	pool->AddChild(CConstStringPtr("chunk"), DEC(usage.mChunkSize));
+	pool->AddChild(CConstStringPtr("chunks"), DEC(usage.mChunks));
+	pool->AddChild(CConstStringPtr("idle_chunks"), DEC(usage.mIdleChunks));
+	pool->AddChild(CConstStringPtr("reserved"), DEC(usage.mReserved));
+	pool->AddChild(CConstStringPtr("alloc"), DEC(usage.mAlloc));
+	pool->AddChild(CConstStringPtr("free"), DEC(usage.mFree));
+	pool->AddChild(CConstStringPtr("live"), DEC(usage.mLive));
+	pool->AddChild(CConstStringPtr("cached"), DEC(usage.mCached));
+	pool->AddChild(CConstStringPtr("thread_cached"), DEC(usage.mThreadCached));
+	pool->AddChild(CConstStringPtr("retries"), DEC(usage.mRetries));
+	pool->AddChild(CConstStringPtr("threads"), DEC(usage.mThreads));
+
+	return pool;
+}
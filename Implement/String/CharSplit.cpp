@@ -28,14 +28,10 @@ void CCharSplitIter::_Begin(void)
 
 	mIsEnd = false;
 	mStart = 0;
-	mEnd = 0;
 
-	/* Find the first non-beginning match */
-	for (; mEnd < size; ++mEnd) {
-		if (mKey == mSrc[mEnd]) {
-			return;
-		}
-	}
+	/* Find the first match */
+	int pos = CStringSearch::FindChar(GetBuf(mSrc), size, mKey);
+	mEnd = (pos < 0) ? size : (uint32_t)pos;
 }
 
 void CCharSplitIter::_Next(void)
@@ -53,11 +49,8 @@ void CCharSplitIter::_Next(void)
 	/* mStart <= size */
 
 	/* Find next */
-	for (mEnd = mStart; mEnd < size; ++mEnd) {
-		if (mKey == mSrc[mEnd]) {
-			return;
-		}
-	}
+	int pos = CStringSearch::FindChar(GetBuf(mSrc) + mStart, size - mStart, mKey);
+	mEnd = (pos < 0) ? size : mStart + pos;
 }
 
 void CCharSplitIter::_Rest(void)
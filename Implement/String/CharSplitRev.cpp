@@ -28,20 +28,9 @@ void CCharSplitRevIter::_Begin(void)
 
 	mIsEnd = false;
 	mEnd = size;
-	mStart = mEnd;
 
-	/* mStart > 0 */
-	do {
-		uint32_t tmp = mStart - 1;
-
-		if (mKey == mSrc[tmp]) {
-			return;
-		}
-
-		mStart = tmp;
-	} while (mStart > 0);
-
-	/* Now mStart == 0 */
+	/* Next to the last match, 0 if none */
+	mStart = CStringSearch::FindCharRev(GetBuf(mSrc), size, mKey) + 1;
 }
 
 void CCharSplitRevIter::_Next(void)
@@ -54,20 +43,10 @@ void CCharSplitRevIter::_Next(void)
 
 	/* mStart > 0 */
 	mEnd = mStart - 1;
-	mStart = mEnd;
-	/* mStart >= 0 */
-
-	while (mStart > 0) {
-		uint32_t tmp = mStart - 1;
-
-		if (mKey == mSrc[tmp]) {
-			return;
-		}
-
-		mStart = tmp;
-	}
+	/* mEnd >= 0 */
 
-	/* Now mStart == 0 */
+	/* Next to the previous match, 0 if none */
+	mStart = CStringSearch::FindCharRev(GetBuf(mSrc), mEnd, mKey) + 1;
 }
 
 void CCharSplitRevIter::_Rest(void)
@@ -28,79 +28,86 @@ CJson::CJson(const CConstStringPtr &key, const CConstStringPtr &val, Type type)
 
 CJson::~CJson(void)
 {
-	/* Does nothing */
+	Drop(mChild);
+	Drop(mSibling);
 }
 
-CConstStringPtr CJson::ToString(void) const
+/* The nodes only owned by the list are destroyed in a loop:
+ * each child is rotated in front of its parent, so the tree
+ * becomes a list of siblings, and every node is destroyed with
+ * no child and no sibling. A node shared with someone else only
+ * loses a reference, its subtree is kept. */
+void CJson::Drop(Link &json)
 {
-	CStringPtr str(STR(GetSize()));
+	Link cur(std::move(json));
 
-	_ToString(str);
+	while (cur && 1 == cur.GetRef()) {
+		if (cur->mChild && 1 == cur->mChild.GetRef()) {
+			Link child(std::move(cur->mChild));
 
-//	TRACE_DEBUG("Json size: ", size, " vs ", str->GetSize(), EOS);
+			cur->mChild = std::move(child->mSibling);
+			child->mSibling = std::move(cur);
+			cur = std::move(child);
+		} else {
+			cur->mChild = nullptr;
 
-	return str;
+			Link next(std::move(cur->mSibling));
+			cur = std::move(next);
+		}
+	}
 }
 
-uint32_t CJson::GetSize(void) const
+CConstStringPtr CJson::ToString(void) const
 {
-	uint32_t size = 0;
+	CStringBuilder str;
 
-	if (mKey) {
-		size += 3 + mKey->GetSize();
-	}
-
-	if (mVal) {
-		size += mVal->GetSize();
-		if (!mVal->IsNum())
-			size += 2;
-	} else if (mChild) {
-		size += 2 + mChild->GetSize();
-	}
-
-	if (mSibling) {
-		size += 1 + mSibling->GetSize();
-	}
+	_ToString(str);
 
-	return size;
+	return str.Flatten();
 }
 
-void CJson::_ToString(CStringPtr &str) const
+void CJson::_ToString(CStringBuilder &str) const
 {
-	if (mKey) {
-		str += "\"";
-		str += mKey;
-		str += "\"";
-		str += ":";
-	}
+	const CJson *json = this;
 
-	if (mVal) {
-		if (mVal->IsNum()) {
-			str += mVal;
-		} else {
-			str += "\"";
-			str += mVal;
-			str += "\"";
+	while (true) {
+
+		if (json->mKey) {
+			str += '"';
+			str += json->mKey;
+			str += "\":";
+		}
+
+		if (json->mVal) {
+			if (json->mVal->IsNum()) {
+				str += json->mVal;
+			} else {
+				str += '"';
+				str += json->mVal;
+				str += '"';
+			}
+		} else if (json->mChild) {
+			switch (json->mChild->GetType()) {
+			case OBJECT:
+				str += '{';
+				json->mChild->_ToString(str);
+				str += '}';
+				break;
+
+			case ARRAY:
+				str += '[';
+				json->mChild->_ToString(str);
+				str += ']';
+				break;
+			}
 		}
-	} else if (mChild) {
-		switch (mChild->GetType()) {
-		case OBJECT:
-			str += "{";
-			mChild->_ToString(str);
-			str += "}";
-			break;
 
-		case ARRAY:
-			str += "[";
-			mChild->_ToString(str);
-			str += "]";
+		if (!json->mSibling) {
 			break;
 		}
-	}
 
-	if (mSibling) {
-		str += ",";
-		mSibling->_ToString(str);
+		str += ',';
+		json = json->mSibling.Get();
 	}
 }
 
@@ -28,14 +28,9 @@ void CLineSplitIter::_Begin(void)
 
 	mIsEnd = false;
 	mStart = 0;
-	mEnd = 0;
 
 	/* Find the first non-beginning match */
-	for (; mEnd < size; ++mEnd) {
-		if (Match(mEnd)) {
-			return;
-		}
-	}
+	Search();
 }
 
 void CLineSplitIter::_Next(void)
@@ -62,11 +57,7 @@ void CLineSplitIter::_Next(void)
 	 * mStart -> next to the previous match. */
 
 	/* Find the first non-beginning match */
-	for (mEnd = mStart; mEnd < size; ++mEnd) {
-		if (Match(mEnd)) {
-			return;
-		}
-	}
+	Search();
 }
 
 void CLineSplitIter::_Rest(void)
@@ -99,3 +90,25 @@ CString::IteratorPtr CLineSplitIter::_Reverse(void)
 	return CLineSplitRevIterPtr(mSrc);
 }
 
+void CLineSplitIter::Search(void)
+{
+	const char *src = GetBuf(mSrc);
+	uint32_t size = mSrc->GetSize();
+
+	/* Only stop at '\r' and '\n', a single '\r' is skipped */
+	for (mEnd = mStart; mEnd < size; ++mEnd) {
+		int pos = CStringSearch::FindAny(src + mEnd, size - mEnd, "\r\n", 2);
+
+		if (pos < 0) {
+			mEnd = size;
+			return;
+		}
+
+		mEnd += pos;
+
+		if (Match(mEnd)) {
+			return;
+		}
+	}
+}
+
@@ -38,6 +38,9 @@ private:
 
 private:
 	inline bool Match(uint32_t idx);
+
+	/* Find the first match from mStart, mEnd -> the match */
+	void Search(void);
 };
 
 inline CLineSplitIter::CLineSplitIter(const CConstStringPtr &src) :
@@ -49,27 +52,28 @@ inline CLineSplitIter::CLineSplitIter(const CConstStringPtr &src) :
 
 inline bool CLineSplitIter::Match(uint32_t idx)
 {
+	const char *src = GetBuf(mSrc);
 	uint32_t size = mSrc->GetSize();
 
 	TRACE_ASSERT(idx < size);
 
-	if ('\r' == mSrc[idx]) {
+	if ('\r' == src[idx]) {
 		++idx;
 
 		/* Only \r\n is considered as new line. */
 		if (idx < size) {
-		   if ('\n' == mSrc[idx]) {
+		   if ('\n' == src[idx]) {
 			   mStep = 2;
 			   return true;
 		   }
 		}
 		/* \r\r or \r* is not considered as new line */
 		return false;
-	} else if ('\n' == mSrc[idx]) {
+	} else if ('\n' == src[idx]) {
 		++idx;
 
 		/* \n\r belongs to one match */
-		if ('\r' == mSrc[idx]) {
+		if (idx < size && '\r' == src[idx]) {
 			mStep = 2;
 		} else {
 			mStep = 1;
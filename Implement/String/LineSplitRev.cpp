@@ -31,17 +31,7 @@ void CLineSplitRevIter::_Begin(void)
 	mStart = mEnd;
 
 	/* mStart > 0 */
-	do {
-		uint32_t tmp = mStart - 1;
-
-		if (Match(tmp)) {
-			return;
-		}
-
-		mStart = tmp;
-	} while (mStart > 0);
-
-	/* Now mStart == 0 */
+	Search();
 }
 
 void CLineSplitRevIter::_Next(void)
@@ -68,17 +58,7 @@ void CLineSplitRevIter::_Next(void)
 	mStart = mEnd;
 
 	/* mStart > 0 */
-	do {
-		uint32_t tmp = mStart - 1;
-
-		if (Match(tmp)) {
-			return;
-		}
-
-		mStart = tmp;
-	} while (mStart > 0);
-
-	/* Now mStart == 0 */
+	Search();
 }
 
 void CLineSplitRevIter::_Rest(void)
@@ -110,3 +90,26 @@ CString::IteratorPtr CLineSplitRevIter::_Reverse(void)
 	return CLineSplitIterPtr(mSrc);
 }
 
+void CLineSplitRevIter::Search(void)
+{
+	const char *src = GetBuf(mSrc);
+
+	/* Only stop at '\r' and '\n', a single '\r' is skipped */
+	while (mStart > 0) {
+		int pos = CStringSearch::FindAnyRev(src, mStart, "\r\n", 2);
+
+		if (pos < 0) {
+			/* Now mStart == 0 */
+			mStart = 0;
+			return;
+		}
+
+		if (Match(pos)) {
+			mStart = pos + 1;
+			return;
+		}
+
+		mStart = pos;
+	}
+}
+
@@ -38,6 +38,9 @@ private:
 
 private:
 	inline bool Match(uint32_t idx);
+
+	/* Find the last match before mStart, mStart -> next to the match */
+	void Search(void);
 };
 
 inline CLineSplitRevIter::CLineSplitRevIter(const CConstStringPtr &src) :
@@ -49,20 +52,22 @@ inline CLineSplitRevIter::CLineSplitRevIter(const CConstStringPtr &src) :
 
 inline bool CLineSplitRevIter::Match(uint32_t idx)
 {
-	if ('\r' == mSrc[idx]) {
+	const char *src = GetBuf(mSrc);
+
+	if ('\r' == src[idx]) {
 		/* Only \n\r is considered as new line. */
 		if (idx > 0) {
-		   if ('\n' == mSrc[idx - 1]) {
+		   if ('\n' == src[idx - 1]) {
 			   mStep = 2;
 			   return true;
 		   }
 		}
 		/* \r\r or \r* is not considered as new line */
 		return false;
-	} else if ('\n' == mSrc[idx]) {
+	} else if ('\n' == src[idx]) {
 		if (idx > 0) {
 			/* \r\n is one match */
-			if ('\r' == mSrc[idx - 1]) {
+			if ('\r' == src[idx - 1]) {
 				mStep = 2;
 				return true;
 			}
@@ -0,0 +1,760 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+#include <String/Number.hpp>
+
+/* =====================================================================
+ *							Integers
+ * ===================================================================== */
+static const char sDigitPairs[] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+static const char sHexDigits[] = "0123456789ABCDEF";
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define NUMBER_SWAR
+#endif
+
+static inline bool IsDigit(char ch)
+{
+	return (uint8_t)(ch - '0') < 10;
+}
+
+static inline uint32_t CountDigits(uint64_t val)
+{
+	uint32_t n = 1;
+
+	for (;;) {
+		if (val < 10) return n;
+		if (val < 100) return n + 1;
+		if (val < 1000) return n + 2;
+		if (val < 10000) return n + 3;
+
+		val /= 10000;
+		n += 4;
+	}
+}
+
+uint32_t CNumber::FormatDec(char *buf, uint64_t val)
+{
+	uint32_t size = CountDigits(val);
+	char *p = buf + size;
+
+	while (val >= 100) {
+		uint32_t i = (uint32_t)(val % 100) << 1;
+
+		val /= 100;
+		*--p = sDigitPairs[i + 1];
+		*--p = sDigitPairs[i];
+	}
+
+	if (val >= 10) {
+		uint32_t i = (uint32_t)val << 1;
+
+		*--p = sDigitPairs[i + 1];
+		*--p = sDigitPairs[i];
+	} else {
+		*--p = (char)('0' + val);
+	}
+
+	return size;
+}
+
+uint32_t CNumber::FormatHex(char *buf, uint64_t val)
+{
+	uint32_t size = 1;
+
+	while (size < 16 && (val >> (size << 2))) {
+		++size;
+	}
+
+	for (char *p = buf + size; p != buf; val >>= 4) {
+		*--p = sHexDigits[val & 0xF];
+	}
+
+	return size;
+}
+
+#ifdef NUMBER_SWAR
+/* Eight chars loaded as a little endian word */
+static inline bool IsEightDigits(uint64_t val)
+{
+	return 0x3333333333333333ULL ==
+		((val & 0xF0F0F0F0F0F0F0F0ULL) |
+		 (((val + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4));
+}
+
+/* Pairs, then quads, then the eight digits are merged by multiplies */
+static inline uint32_t ParseEightDigits(uint64_t val)
+{
+	const uint64_t mask = 0x000000FF000000FFULL;
+	const uint64_t mul1 = 100 + (1000000ULL << 32);
+	const uint64_t mul2 = 1 + (10000ULL << 32);
+
+	val -= 0x3030303030303030ULL;
+	val = (val * 10) + (val >> 8);
+	val = (((val & mask) * mul1) + (((val >> 16) & mask) * mul2)) >> 32;
+
+	return (uint32_t)val;
+}
+#endif
+
+/* 19 digits never overflow, only the 20th is checked */
+uint32_t CNumber::ParseDec(const char *buf, uint32_t size, uint64_t &val)
+{
+	const char *p = buf;
+	const char *end = buf + size;
+	const char *start;
+	const char *safe;
+	uint64_t ret = 0;
+
+	while (p < end && '0' == *p) {
+		++p;
+	}
+
+	start = p;
+	safe = (end - start > 19) ? start + 19 : end;
+
+#ifdef NUMBER_SWAR
+	while (end - p >= 8 && p - start <= 11) {
+		uint64_t chunk;
+
+		::memcpy(&chunk, p, sizeof(chunk));
+		if (!IsEightDigits(chunk)) {
+			break;
+		}
+
+		ret = ret * 100000000 + ParseEightDigits(chunk);
+		p += 8;
+	}
+#endif
+
+	for (; p < safe && IsDigit(*p); ++p) {
+		ret = ret * 10 + (*p - '0');
+	}
+
+	if (p < end && IsDigit(*p)) {
+		uint32_t digit = *p - '0';
+
+		if (ret > (UINT64_MAX - digit) / 10 ||
+			(p + 1 < end && IsDigit(p[1]))) {
+			return 0;
+		}
+
+		ret = ret * 10 + digit;
+		++p;
+	}
+
+	if (p == buf) {
+		return 0;
+	}
+
+	val = ret;
+
+	return (uint32_t)(p - buf);
+}
+
+uint32_t CNumber::ParseHex(const char *buf, uint32_t size, uint64_t &val)
+{
+	const char *p = buf;
+	const char *end = buf + size;
+	uint32_t digits = 0;
+	uint64_t ret = 0;
+
+	for (; p < end; ++p) {
+		char ch = *p;
+		uint32_t digit;
+
+		if (IsDigit(ch)) {
+			digit = ch - '0';
+		} else if (ch >= 'A' && ch <= 'F') {
+			digit = ch - 'A' + 10;
+		} else if (ch >= 'a' && ch <= 'f') {
+			digit = ch - 'a' + 10;
+		} else {
+			break;
+		}
+
+		/* Leading zeros are not counted */
+		if ((0 != ret || 0 != digit) && ++digits > 16) {
+			return 0;
+		}
+
+		ret = (ret << 4) | digit;
+	}
+
+	if (p == buf) {
+		return 0;
+	}
+
+	val = ret;
+
+	return (uint32_t)(p - buf);
+}
+
+/* =====================================================================
+ *							Grisu2
+ * ===================================================================== */
+/* Florian Loitsch, "Printing Floating-Point Numbers Quickly and
+ * Accurately with Integers". The double and its boundaries are
+ * scaled by a cached power of ten so that the digits come out of
+ * integer operations. The result always reads back to the same
+ * double and is the shortest one in nearly all the cases. */
+#define DP_FRAC_MASK	0x000FFFFFFFFFFFFFULL
+#define DP_HIDDEN_BIT	0x0010000000000000ULL
+#define DP_EXP_MASK		0x7FF
+#define DP_EXP_BIAS		1075
+
+struct CDiyFp
+{
+	uint64_t f;
+	int e;
+};
+
+/* 10^k for k = -348, -340, ..., 340 */
+static const CDiyFp sCachedPowers[] = {
+	{0xFA8FD5A0081C0288ULL, -1220}, {0xBAAEE17FA23EBF76ULL, -1193},
+	{0x8B16FB203055AC76ULL, -1166}, {0xCF42894A5DCE35EAULL, -1140},
+	{0x9A6BB0AA55653B2DULL, -1113}, {0xE61ACF033D1A45DFULL, -1087},
+	{0xAB70FE17C79AC6CAULL, -1060}, {0xFF77B1FCBEBCDC4FULL, -1034},
+	{0xBE5691EF416BD60CULL, -1007}, {0x8DD01FAD907FFC3CULL, -980},
+	{0xD3515C2831559A83ULL, -954}, {0x9D71AC8FADA6C9B5ULL, -927},
+	{0xEA9C227723EE8BCBULL, -901}, {0xAECC49914078536DULL, -874},
+	{0x823C12795DB6CE57ULL, -847}, {0xC21094364DFB5637ULL, -821},
+	{0x9096EA6F3848984FULL, -794}, {0xD77485CB25823AC7ULL, -768},
+	{0xA086CFCD97BF97F4ULL, -741}, {0xEF340A98172AACE5ULL, -715},
+	{0xB23867FB2A35B28EULL, -688}, {0x84C8D4DFD2C63F3BULL, -661},
+	{0xC5DD44271AD3CDBAULL, -635}, {0x936B9FCEBB25C996ULL, -608},
+	{0xDBAC6C247D62A584ULL, -582}, {0xA3AB66580D5FDAF6ULL, -555},
+	{0xF3E2F893DEC3F126ULL, -529}, {0xB5B5ADA8AAFF80B8ULL, -502},
+	{0x87625F056C7C4A8BULL, -475}, {0xC9BCFF6034C13053ULL, -449},
+	{0x964E858C91BA2655ULL, -422}, {0xDFF9772470297EBDULL, -396},
+	{0xA6DFBD9FB8E5B88FULL, -369}, {0xF8A95FCF88747D94ULL, -343},
+	{0xB94470938FA89BCFULL, -316}, {0x8A08F0F8BF0F156BULL, -289},
+	{0xCDB02555653131B6ULL, -263}, {0x993FE2C6D07B7FACULL, -236},
+	{0xE45C10C42A2B3B06ULL, -210}, {0xAA242499697392D3ULL, -183},
+	{0xFD87B5F28300CA0EULL, -157}, {0xBCE5086492111AEBULL, -130},
+	{0x8CBCCC096F5088CCULL, -103}, {0xD1B71758E219652CULL, -77},
+	{0x9C40000000000000ULL, -50}, {0xE8D4A51000000000ULL, -24},
+	{0xAD78EBC5AC620000ULL, 3}, {0x813F3978F8940984ULL, 30},
+	{0xC097CE7BC90715B3ULL, 56}, {0x8F7E32CE7BEA5C70ULL, 83},
+	{0xD5D238A4ABE98068ULL, 109}, {0x9F4F2726179A2245ULL, 136},
+	{0xED63A231D4C4FB27ULL, 162}, {0xB0DE65388CC8ADA8ULL, 189},
+	{0x83C7088E1AAB65DBULL, 216}, {0xC45D1DF942711D9AULL, 242},
+	{0x924D692CA61BE758ULL, 269}, {0xDA01EE641A708DEAULL, 295},
+	{0xA26DA3999AEF774AULL, 322}, {0xF209787BB47D6B85ULL, 348},
+	{0xB454E4A179DD1877ULL, 375}, {0x865B86925B9BC5C2ULL, 402},
+	{0xC83553C5C8965D3DULL, 428}, {0x952AB45CFA97A0B3ULL, 455},
+	{0xDE469FBD99A05FE3ULL, 481}, {0xA59BC234DB398C25ULL, 508},
+	{0xF6C69A72A3989F5CULL, 534}, {0xB7DCBF5354E9BECEULL, 561},
+	{0x88FCF317F22241E2ULL, 588}, {0xCC20CE9BD35C78A5ULL, 614},
+	{0x98165AF37B2153DFULL, 641}, {0xE2A0B5DC971F303AULL, 667},
+	{0xA8D9D1535CE3B396ULL, 694}, {0xFB9B7CD9A4A7443CULL, 720},
+	{0xBB764C4CA7A44410ULL, 747}, {0x8BAB8EEFB6409C1AULL, 774},
+	{0xD01FEF10A657842CULL, 800}, {0x9B10A4E5E9913129ULL, 827},
+	{0xE7109BFBA19C0C9DULL, 853}, {0xAC2820D9623BF429ULL, 880},
+	{0x80444B5E7AA7CF85ULL, 907}, {0xBF21E44003ACDD2DULL, 933},
+	{0x8E679C2F5E44FF8FULL, 960}, {0xD433179D9C8CB841ULL, 986},
+	{0x9E19DB92B4E31BA9ULL, 1013}, {0xEB96BF6EBADF77D9ULL, 1039},
+	{0xAF87023B9BF0EE6BULL, 1066},
+};
+
+static const uint32_t sPow10[] = {
+	1, 10, 100, 1000, 10000, 100000,
+	1000000, 10000000, 100000000, 1000000000
+};
+
+static inline CDiyFp DiyFp(uint64_t f, int e)
+{
+	CDiyFp ret = {f, e};
+
+	return ret;
+}
+
+/* The upper 64 bits of the product, rounded */
+static inline CDiyFp Mul(const CDiyFp &x, const CDiyFp &y)
+{
+	const uint64_t M32 = 0xFFFFFFFFULL;
+	uint64_t a = x.f >> 32;
+	uint64_t b = x.f & M32;
+	uint64_t c = y.f >> 32;
+	uint64_t d = y.f & M32;
+	uint64_t ac = a * c;
+	uint64_t bc = b * c;
+	uint64_t ad = a * d;
+	uint64_t bd = b * d;
+	uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32) + (1ULL << 31);
+
+	return DiyFp(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64);
+}
+
+static inline CDiyFp Normalize(CDiyFp x)
+{
+#ifdef __GNUC__
+	int shift = __builtin_clzll(x.f);
+
+	x.f <<= shift;
+	x.e -= shift;
+#else
+	while (0 == (x.f & 0x8000000000000000ULL)) {
+		x.f <<= 1;
+		--x.e;
+	}
+#endif
+
+	return x;
+}
+
+/* v and its boundaries m- and m+, the half way points to the
+ * neighbours. m- and m+ share the exponent of the normalized m+. */
+static inline void Boundaries(double d, CDiyFp &v, CDiyFp &minus, CDiyFp &plus)
+{
+	uint64_t bits;
+
+	::memcpy(&bits, &d, sizeof(bits));
+
+	uint64_t frac = bits & DP_FRAC_MASK;
+	int exp = (int)((bits >> 52) & DP_EXP_MASK);
+
+	if (0 != exp) {
+		v = DiyFp(frac | DP_HIDDEN_BIT, exp - DP_EXP_BIAS);
+	} else {
+		v = DiyFp(frac, 1 - DP_EXP_BIAS);
+	}
+
+	plus = Normalize(DiyFp((v.f << 1) + 1, v.e - 1));
+
+	/* A power of two has a closer lower neighbour */
+	if (0 == frac && exp > 1) {
+		minus = DiyFp((v.f << 2) - 1, v.e - 2);
+	} else {
+		minus = DiyFp((v.f << 1) - 1, v.e - 1);
+	}
+
+	minus.f <<= minus.e - plus.e;
+	minus.e = plus.e;
+	v = Normalize(v);
+}
+
+/* 10^-K so that the product with 2^e has its
+ * exponent in [-60, -32]. */
+static inline CDiyFp CachedPower(int e, int &K)
+{
+	double dk = (-61 - e) * 0.30102999566398114 + 347;
+	int k = (int)dk;
+
+	if (dk - k > 0.0) {
+		++k;
+	}
+
+	uint32_t index = (uint32_t)((k >> 3) + 1);
+
+	K = -(-348 + (int)(index << 3));
+
+	return sCachedPowers[index];
+}
+
+/* Moves the last digit towards w while it stays in the range */
+static inline void GrisuRound(char *buf, int len, uint64_t delta, uint64_t rest,
+							  uint64_t tenKappa, uint64_t wpw)
+{
+	while (rest < wpw && delta - rest >= tenKappa &&
+		   (rest + tenKappa < wpw || wpw - rest > rest + tenKappa - wpw)) {
+		buf[len - 1]--;
+		rest += tenKappa;
+	}
+}
+
+/* Generates the digits of Mp until the rest is in delta */
+static inline int DigitGen(const CDiyFp &W, const CDiyFp &Mp, uint64_t delta,
+						   char *buf, int &K)
+{
+	const CDiyFp one = DiyFp(1ULL << -Mp.e, Mp.e);
+	const uint64_t wpw = Mp.f - W.f;
+	uint32_t p1 = (uint32_t)(Mp.f >> -one.e);
+	uint64_t p2 = Mp.f & (one.f - 1);
+	int kappa = CountDigits(p1);
+	int len = 0;
+
+	while (kappa > 0) {
+		uint32_t div = sPow10[kappa - 1];
+		uint32_t d = p1 / div;
+
+		p1 %= div;
+
+		if (0 != d || 0 != len) {
+			buf[len++] = (char)('0' + d);
+		}
+
+		--kappa;
+
+		uint64_t rest = ((uint64_t)p1 << -one.e) + p2;
+
+		if (rest <= delta) {
+			K += kappa;
+			GrisuRound(buf, len, delta, rest, (uint64_t)sPow10[kappa] << -one.e, wpw);
+			return len;
+		}
+	}
+
+	while (true) {
+		p2 *= 10;
+		delta *= 10;
+
+		char d = (char)(p2 >> -one.e);
+
+		if (0 != d || 0 != len) {
+			buf[len++] = (char)('0' + d);
+		}
+
+		p2 &= one.f - 1;
+		--kappa;
+
+		if (p2 < delta) {
+			K += kappa;
+			GrisuRound(buf, len, delta, p2, one.f,
+					   wpw * ((-kappa < 9) ? sPow10[-kappa] : 0));
+			return len;
+		}
+	}
+}
+
+/* d > 0, the digits of d are d = buf * 10^K */
+static inline int Grisu2(double d, char *buf, int &K)
+{
+	CDiyFp v;
+	CDiyFp minus;
+	CDiyFp plus;
+
+	Boundaries(d, v, minus, plus);
+
+	CDiyFp c = CachedPower(plus.e, K);
+	CDiyFp W = Mul(v, c);
+	CDiyFp Wp = Mul(plus, c);
+	CDiyFp Wm = Mul(minus, c);
+
+	/* Stay strictly inside the range, the products are rounded */
+	++Wm.f;
+	--Wp.f;
+
+	return DigitGen(W, Wp, Wp.f - Wm.f, buf, K);
+}
+
+/* =====================================================================
+ *							Doubles
+ * ===================================================================== */
+/* Exact in a double */
+static const double sPow10Double[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* The fixed form unless the scientific one is shorter */
+static uint32_t FormatDigits(char *buf, const char *digits, int len, int K)
+{
+	int point = len + K;
+	int exp = point - 1;
+	int expSize = (exp >= 100 || exp <= -100) ? 3 : 2;
+	int sciSize = len + ((len > 1) ? 1 : 0) + 2 + expSize;
+	int fixSize;
+
+	if (K >= 0) {
+		fixSize = len + K;
+	} else if (point > 0) {
+		fixSize = len + 1;
+	} else {
+		fixSize = 2 - point + len;
+	}
+
+	if (fixSize <= sciSize) {
+		if (K >= 0) {
+			::memcpy(buf, digits, len);
+			::memset(buf + len, '0', K);
+		} else if (point > 0) {
+			::memcpy(buf, digits, point);
+			buf[point] = '.';
+			::memcpy(buf + point + 1, digits + point, len - point);
+		} else {
+			buf[0] = '0';
+			buf[1] = '.';
+			::memset(buf + 2, '0', -point);
+			::memcpy(buf + 2 - point, digits, len);
+		}
+
+		return fixSize;
+	}
+
+	char *p = buf;
+
+	*p++ = digits[0];
+
+	if (len > 1) {
+		*p++ = '.';
+		::memcpy(p, digits + 1, len - 1);
+		p += len - 1;
+	}
+
+	*p++ = 'e';
+	*p++ = (exp < 0) ? '-' : '+';
+
+	if (exp < 0) {
+		exp = -exp;
+	}
+
+	if (exp >= 100) {
+		*p++ = (char)('0' + exp / 100);
+		exp %= 100;
+	}
+
+	*p++ = sDigitPairs[exp << 1];
+	*p++ = sDigitPairs[(exp << 1) + 1];
+
+	return (uint32_t)(p - buf);
+}
+
+uint32_t CNumber::ToDec(char *buf, double val)
+{
+	uint32_t size = 0;
+	char digits[20];
+	int K = 0;
+
+	if (val != val) {
+		::memcpy(buf, "nan", 3);
+		return 3;
+	}
+
+	if (::signbit(val)) {
+		buf[size++] = '-';
+		val = -val;
+	}
+
+	if (val == 0.0) {
+		buf[size++] = '0';
+		return size;
+	}
+
+	if (val > 1.7976931348623157e308) {
+		::memcpy(buf + size, "inf", 3);
+		return size + 3;
+	}
+
+	int len = Grisu2(val, digits, K);
+
+	return size + FormatDigits(buf + size, digits, len, K);
+}
+
+/* 10^1 to 10^7, normalized */
+static const CDiyFp sPow10Diy[] = {
+	{0xA000000000000000ULL, -60}, {0xC800000000000000ULL, -57},
+	{0xFA00000000000000ULL, -54}, {0x9C40000000000000ULL, -50},
+	{0xC350000000000000ULL, -47}, {0xF424000000000000ULL, -44},
+	{0x9896800000000000ULL, -40},
+};
+
+#define DP_ULP_SHIFT	3
+#define DP_ULP			(1 << DP_ULP_SHIFT)
+
+/* m * 10^exp10 with the cached powers of Grisu2, as in RapidJSON's
+ * StrtodDiyFp. The error of the product is tracked in 1/8 units of
+ * its last bit; false if it may round either way, or the result is
+ * subnormal or too big. m was rounded to 19 digits if truncated. */
+static bool FastDec(uint64_t m, int digits, bool truncated, int exp10, double &val)
+{
+	if (exp10 < -348 || exp10 > 340) {
+		return false;
+	}
+
+	uint64_t error = truncated ? DP_ULP / 2 : 0;
+	CDiyFp v = Normalize(DiyFp(m, 0));
+	uint32_t index = (uint32_t)(exp10 + 348) >> 3;
+	int adjust = exp10 - (-348 + (int)(index << 3));
+
+	error <<= -v.e;
+
+	if (0 != adjust) {
+		v = Mul(v, sPow10Diy[adjust - 1]);
+
+		/* m * 10^adjust may not fit in 64 bits */
+		if (digits + adjust > 19) {
+			error += DP_ULP / 2;
+		}
+	}
+
+	v = Mul(v, sCachedPowers[index]);
+	error += DP_ULP + (0 == error ? 0 : 1);
+
+	int e = v.e;
+
+	v = Normalize(v);
+	error <<= e - v.e;
+
+	/* Subnormal, 53 bits do not fit */
+	if (64 + v.e < -1021) {
+		return false;
+	}
+
+	uint64_t f = v.f >> 11;
+	uint64_t bits = (v.f & 0x7FF) * DP_ULP;
+	uint64_t half = (1ULL << 10) * DP_ULP;
+
+	if (half - error < bits && bits < half + error) {
+		return false;
+	}
+
+	e = v.e + 11;
+
+	if (bits >= half + error && (++f & (DP_HIDDEN_BIT << 1))) {
+		f >>= 1;
+		++e;
+	}
+
+	/* Overflow */
+	if (e + DP_EXP_BIAS >= DP_EXP_MASK) {
+		return false;
+	}
+
+	bits = (f & DP_FRAC_MASK) | ((uint64_t)(e + DP_EXP_BIAS) << 52);
+	::memcpy(&val, &bits, sizeof(val));
+
+	return true;
+}
+
+#undef DP_ULP
+#undef DP_ULP_SHIFT
+#undef DP_FRAC_MASK
+#undef DP_HIDDEN_BIT
+#undef DP_EXP_MASK
+#undef DP_EXP_BIAS
+
+/* Up to 19 digits and 10^22 are exact, so one multiply or divide
+ * is correctly rounded. Most of the rest goes through FastDec(),
+ * only the cases it cannot decide are left to strtod(). */
+uint32_t CNumber::FromDec(const char *buf, uint32_t size, double &val)
+{
+	const char *p = buf;
+	const char *end = buf + size;
+	bool neg = false;
+	bool any = false;
+	bool exact = true;
+	bool up = false;
+	uint64_t m = 0;
+	int digits = 0;
+	int exp10 = 0;
+	double ret;
+
+	if (p < end && '-' == *p) {
+		neg = true;
+		++p;
+	}
+
+	for (; p < end && IsDigit(*p); ++p) {
+		any = true;
+
+		if (digits < 19) {
+			if (0 != m || '0' != *p) {
+				m = m * 10 + (*p - '0');
+				++digits;
+			}
+		} else {
+			/* The first dropped digit rounds m */
+			up = exact ? (*p >= '5') : up;
+			exact = false;
+			++exp10;
+		}
+	}
+
+	if (p < end && '.' == *p) {
+		for (++p; p < end && IsDigit(*p); ++p) {
+			any = true;
+
+			if (digits < 19) {
+				if (0 != m || '0' != *p) {
+					m = m * 10 + (*p - '0');
+					++digits;
+				}
+				--exp10;
+			} else {
+				up = exact ? (*p >= '5') : up;
+				exact = false;
+			}
+		}
+	}
+
+	if (!any) {
+		return 0;
+	}
+
+	/* The exponent needs a digit, or the 'e' is not part of it */
+	if (p < end && ('e' == *p || 'E' == *p)) {
+		const char *q = p + 1;
+		bool eneg = false;
+		int exp = 0;
+
+		if (q < end && ('-' == *q || '+' == *q)) {
+			eneg = ('-' == *q);
+			++q;
+		}
+
+		if (q < end && IsDigit(*q)) {
+			for (; q < end && IsDigit(*q); ++q) {
+				if (exp < 100000) {
+					exp = exp * 10 + (*q - '0');
+				}
+			}
+
+			exp10 += eneg ? -exp : exp;
+			p = q;
+		}
+	}
+
+	uint32_t used = (uint32_t)(p - buf);
+
+	if (exact && 0 == m) {
+		ret = 0.0;
+	} else if (exact && m <= (1ULL << 53) && exp10 >= -22 && exp10 <= 22) {
+		ret = (exp10 < 0) ? (double)m / sPow10Double[-exp10] :
+			(double)m * sPow10Double[exp10];
+	} else if (!FastDec(m + (up ? 1 : 0), digits, !exact, exp10, ret)) {
+		char tmp[64];
+		char *str = (used < sizeof(tmp)) ? tmp : new char[used + 1];
+
+		::memcpy(str, buf, used);
+		str[used] = '\0';
+		ret = ::strtod(str, NULL);
+
+		if (str != tmp) {
+			delete [] str;
+		}
+
+		/* strtod() gives the sign itself */
+		neg = false;
+
+		/* Overflow */
+		if (ret > 1.7976931348623157e308 || ret < -1.7976931348623157e308) {
+			return 0;
+		}
+	}
+
+	val = neg ? -ret : ret;
+
+	return used;
+}
@@ -21,12 +21,14 @@
 #include "TokenSplit.hpp"
 #include "StringSplit.hpp"
 
-CString::IteratorPtr CString::Split(const CConstStringPtr &str) const
+/* The iterator outlives the call, so it holds the key
+ * (see CStringRef::ToString()). A single char is copied. */
+CString::IteratorPtr CString::Split(const CStringRef &str) const
 {
-	if (1 == str->GetSize()) {
+	if (1 == str.GetSize()) {
 		return CCharSplitIterPtr(Slice(0, -1), str[0]);
 	} else {
-		return CStringSplitIterPtr(Slice(0, -1), str);
+		return CStringSplitIterPtr(Slice(0, -1), str.ToString());
 	}
 }
 
@@ -19,32 +19,15 @@
 
 CStringPtr CStringArr::Join(void) const
 {
-	if (mSize >= DEFAULT_STR_SIZE) {
-		return DoJoin(CMemPtr(new char[mSize], CMemPtr::ArrayDeleter), mSize + 1);
-	}else {
-		return DoJoin(StringBufPool::Alloc(), DEFAULT_STR_SIZE);
-	}
-}
+	CStringBuilder str;
 
-CStringPtr CStringArr::DoJoin(const CMemPtr &mem, uint32_t capacity) const
-{
-	CStringPtr str(mem, capacity);
-	char *buf = str->GetPtr();
-	uint32_t size = 0;
+	str.Reserve(mSize);
 
 	for (uint32_t i = 0; i < mStrs.size(); ++i) {
-		CStringPtr tmp(mStrs[i]);
-		::memcpy(&buf[size], tmp->GetPtr(), tmp->GetSize());
-		size += tmp->GetSize();
+		str += mStrs[i];
 	}
 
-	buf[size] = '\0';
-
-	CHECK_PARAM(size == mSize, "Illegal size to join: %d vs %d", size, mSize);
-
-	str->mSize = size;
-
-	return str;
+	return str.Flatten();
 }
 
 void CStringArr::operator += (const CStringPtr &str)
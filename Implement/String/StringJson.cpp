@@ -119,7 +119,7 @@ private:
 		return -1;
 	}
 
-	inline bool ParseKey(CJsonPtr &node)
+	inline bool ParseKey(CJson *node)
 	{
 		/* Key must start with >>> " <<< */
 		JSON_CHECK(IsNextChar('"'), "key does not start with >>> \" <<<");
@@ -145,13 +145,13 @@ private:
 		return true;
 	}
 
-	inline void SetVal(CJsonPtr &node, uint32_t idx)
+	inline void SetVal(CJson *node, uint32_t idx)
 	{
 		JSON_DEBUG("Set val: >>> ", mStr->Slice(mStart, idx), " <<<\n");
 		node->SetVal(mStr->Slice(mStart, idx));
 	}
 
-	inline bool ParseVal(CJsonPtr &node)
+	inline bool ParseVal(CJson *node)
 	{
 		Strip();
 
@@ -195,16 +195,22 @@ private:
 		JSON_ERROR("I will not reach here!");
 	}
 
-	inline bool DoParse(CJsonPtr &root, CJson::Type type)
+	inline bool DoParse(CJson *root, CJson::Type type)
 	{
 		/* mStart => previous token */
 		++mStart;
 
 		JSON_DEBUG("Start parsing ", type == CJson::OBJECT? "object" : "array", EOS);
 
+		/* The children are linked in place, so neither the list
+		 * is walked nor the nodes are shared for each child. */
+		CJson::Link *tail = &CJson::GetTail(root->mChild);
+
 		while (true) {
-			CJsonPtr child(nullptr, nullptr, type);
-			root->AddChild(child);
+			*tail = CJsonPtr(nullptr, nullptr, type);
+
+			CJson *child = tail->Get();
+			tail = &child->mSibling;
 
 			/* Only CJson::OBJECT has the keys */
 			if (CJson::OBJECT == type) {
@@ -242,7 +248,7 @@ private:
 	inline bool Parse(CJsonPtr &root)
 	{
 		JSON_CHECK(IsNextChar('{'), "Start >>> { <<< is not found");
-		JSON_CHECK(DoParse(root, CJson::OBJECT), "Fail to parse");
+		JSON_CHECK(DoParse(root.Get(), CJson::OBJECT), "Fail to parse");
 		return true;
 	}
 };
@@ -0,0 +1,498 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <String/StringSearch.hpp>
+
+#define SEARCH_SET_SIZE 4
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define STRING_SEARCH_X86
+#endif
+
+struct CSearchKernel
+{
+	CStringSearch::Level mLevel;
+	int (*mFindChar)(const char *, uint32_t, char);
+	int (*mFindCharRev)(const char *, uint32_t, char);
+	int (*mFindStr)(const char *, uint32_t, const char *, uint32_t);
+	int (*mFindStrRev)(const char *, uint32_t, const char *, uint32_t);
+	int (*mFindSet)(const char *, uint32_t, const char *, bool);
+	int (*mFindSetRev)(const char *, uint32_t, const char *, bool);
+};
+
+/* =====================================================================
+ *							Plain loops
+ * ===================================================================== */
+static int FindCharScalar(const char *buf, uint32_t size, char ch)
+{
+	for (uint32_t i = 0; i < size; ++i) {
+		if (buf[i] == ch) {
+			return (int)i;
+		}
+	}
+
+	return -1;
+}
+
+static int FindCharRevScalar(const char *buf, uint32_t size, char ch)
+{
+	for (int i = (int)size - 1; i >= 0; --i) {
+		if (buf[i] == ch) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static int FindStrScalar(const char *buf, uint32_t size,
+						 const char *key, uint32_t ksize)
+{
+	for (uint32_t i = 0; i + ksize <= size; ++i) {
+		if (buf[i] == key[0] && 0 == ::memcmp(&buf[i + 1], key + 1, ksize - 1)) {
+			return (int)i;
+		}
+	}
+
+	return -1;
+}
+
+static int FindStrRevScalar(const char *buf, uint32_t size,
+							const char *key, uint32_t ksize)
+{
+	for (int i = (int)(size - ksize); i >= 0; --i) {
+		if (buf[i] == key[0] && 0 == ::memcmp(&buf[i + 1], key + 1, ksize - 1)) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/* set has SEARCH_SET_SIZE chars, skip looks for a char not in it */
+static inline bool InSet(char ch, const char *set)
+{
+	return ch == set[0] || ch == set[1] || ch == set[2] || ch == set[3];
+}
+
+static int FindSetScalar(const char *buf, uint32_t size, const char *set, bool skip)
+{
+	for (uint32_t i = 0; i < size; ++i) {
+		if (InSet(buf[i], set) != skip) {
+			return (int)i;
+		}
+	}
+
+	return -1;
+}
+
+static int FindSetRevScalar(const char *buf, uint32_t size, const char *set, bool skip)
+{
+	for (int i = (int)size - 1; i >= 0; --i) {
+		if (InSet(buf[i], set) != skip) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static const CSearchKernel sScalar = {
+	CStringSearch::SCALAR,
+	FindCharScalar,
+	FindCharRevScalar,
+	FindStrScalar,
+	FindStrRevScalar,
+	FindSetScalar,
+	FindSetRevScalar,
+};
+
+#ifdef STRING_SEARCH_X86
+
+/* The kernels of SSE2 and AVX2 only differ by the vector,
+ * VEC_BYTES is the number of positions tested at once.
+ *
+ * A buffer shorter than a vector is given to the kernels of the
+ * tail before any vector is used: calling them after AVX2 would
+ * pay the AVX-SSE transition. The positions left after the loop
+ * are tested by a last vector overlapping the tested ones. */
+#define SEARCH_KERNELS(name, tail, attr, vec, VEC_BYTES,				\
+					   set1, loadu, cmpeq, andv, orv, movemask)		\
+																	\
+attr static inline uint32_t name##Match(const char *p, vec key)	\
+{																	\
+	return (uint32_t)movemask(cmpeq(loadu((const vec *)p), key));	\
+}																	\
+																	\
+attr static int FindChar##name(const char *buf, uint32_t size, char ch)	\
+{																	\
+	if (size < VEC_BYTES) {											\
+		return FindChar##tail(buf, size, ch);						\
+	}																\
+																	\
+	const vec key = set1(ch);										\
+	uint32_t i = 0;													\
+	uint32_t mask;													\
+																	\
+	for (; i + VEC_BYTES <= size; i += VEC_BYTES) {					\
+		mask = name##Match(buf + i, key);							\
+		if (0 != mask) {											\
+			return (int)(i + __builtin_ctz(mask));					\
+		}															\
+	}																\
+																	\
+	if (i < size) {													\
+		mask = name##Match(buf + size - VEC_BYTES, key) >> (VEC_BYTES - (size - i));	\
+		if (0 != mask) {											\
+			return (int)(i + __builtin_ctz(mask));					\
+		}															\
+	}																\
+																	\
+	return -1;														\
+}																	\
+																	\
+attr static int FindCharRev##name(const char *buf, uint32_t size, char ch)	\
+{																	\
+	if (size < VEC_BYTES) {											\
+		return FindCharRev##tail(buf, size, ch);					\
+	}																\
+																	\
+	const vec key = set1(ch);										\
+	uint32_t i = size;												\
+	uint32_t mask;													\
+																	\
+	while (i >= VEC_BYTES) {										\
+		i -= VEC_BYTES;												\
+		mask = name##Match(buf + i, key);							\
+		if (0 != mask) {											\
+			return (int)(i + 31 - __builtin_clz(mask));				\
+		}															\
+	}																\
+																	\
+	if (0 != i) {													\
+		mask = name##Match(buf, key) & ((1U << i) - 1);				\
+		if (0 != mask) {											\
+			return (int)(31 - __builtin_clz(mask));					\
+		}															\
+	}																\
+																	\
+	return -1;														\
+}																	\
+																	\
+/* A position is tested only if its first and last chars match */	\
+attr static inline uint32_t name##Filter(const char *p, vec first,	\
+										 vec last, uint32_t ksize)	\
+{																	\
+	return (uint32_t)movemask(andv(									\
+		cmpeq(loadu((const vec *)p), first),						\
+		cmpeq(loadu((const vec *)(p + ksize - 1)), last)));			\
+}																	\
+																	\
+/* The positions of mask start at pos */							\
+static inline int name##First(const char *buf, uint32_t pos, uint32_t mask,	\
+							  const char *key, uint32_t ksize)		\
+{																	\
+	while (0 != mask) {												\
+		uint32_t i = pos + __builtin_ctz(mask);						\
+		if (0 == ::memcmp(&buf[i + 1], key + 1, ksize - 2)) {		\
+			return (int)i;											\
+		}															\
+		mask &= mask - 1;											\
+	}																\
+																	\
+	return -1;														\
+}																	\
+																	\
+static inline int name##Last(const char *buf, uint32_t pos, uint32_t mask,	\
+							 const char *key, uint32_t ksize)		\
+{																	\
+	while (0 != mask) {												\
+		uint32_t bit = 31 - __builtin_clz(mask);					\
+		if (0 == ::memcmp(&buf[pos + bit + 1], key + 1, ksize - 2)) {	\
+			return (int)(pos + bit);								\
+		}															\
+		mask &= ~(1U << bit);										\
+	}																\
+																	\
+	return -1;														\
+}																	\
+																	\
+attr static int FindStr##name(const char *buf, uint32_t size,		\
+							  const char *key, uint32_t ksize)		\
+{																	\
+	/* Number of positions */										\
+	uint32_t count = size - ksize + 1;								\
+																	\
+	if (count < VEC_BYTES) {										\
+		return FindStr##tail(buf, size, key, ksize);				\
+	}																\
+																	\
+	const vec first = set1(key[0]);									\
+	const vec last = set1(key[ksize - 1]);							\
+	uint32_t i = 0;													\
+	int ret;														\
+																	\
+	for (; i + VEC_BYTES <= count; i += VEC_BYTES) {				\
+		ret = name##First(buf, i, name##Filter(buf + i, first, last, ksize), key, ksize);	\
+		if (ret >= 0) {												\
+			return ret;												\
+		}															\
+	}																\
+																	\
+	if (i < count) {												\
+		uint32_t mask = name##Filter(buf + count - VEC_BYTES, first, last, ksize);	\
+		return name##First(buf, i, mask >> (VEC_BYTES - (count - i)), key, ksize);	\
+	}																\
+																	\
+	return -1;														\
+}																	\
+																	\
+attr static int FindStrRev##name(const char *buf, uint32_t size,	\
+								 const char *key, uint32_t ksize)	\
+{																	\
+	uint32_t i = size - ksize + 1;									\
+																	\
+	if (i < VEC_BYTES) {											\
+		return FindStrRev##tail(buf, size, key, ksize);				\
+	}																\
+																	\
+	const vec first = set1(key[0]);									\
+	const vec last = set1(key[ksize - 1]);							\
+	int ret;														\
+																	\
+	while (i >= VEC_BYTES) {										\
+		i -= VEC_BYTES;												\
+		ret = name##Last(buf, i, name##Filter(buf + i, first, last, ksize), key, ksize);	\
+		if (ret >= 0) {												\
+			return ret;												\
+		}															\
+	}																\
+																	\
+	if (0 != i) {													\
+		uint32_t mask = name##Filter(buf, first, last, ksize);		\
+		return name##Last(buf, 0, mask & ((1U << i) - 1), key, ksize);	\
+	}																\
+																	\
+	return -1;														\
+}																	\
+																	\
+/* One bit for each char in the set (or not in it for skip) */		\
+attr static inline uint32_t name##SetMask(const char *p, const vec *set, bool skip)	\
+{																	\
+	const vec v = loadu((const vec *)p);							\
+	uint32_t mask = (uint32_t)movemask(orv(							\
+		orv(cmpeq(v, set[0]), cmpeq(v, set[1])),					\
+		orv(cmpeq(v, set[2]), cmpeq(v, set[3]))));					\
+																	\
+	return skip ? (~mask & (uint32_t)((1ULL << VEC_BYTES) - 1)) : mask;	\
+}																	\
+																	\
+attr static int FindSet##name(const char *buf, uint32_t size, const char *key, bool skip)	\
+{																	\
+	if (size < VEC_BYTES) {											\
+		return FindSet##tail(buf, size, key, skip);					\
+	}																\
+																	\
+	const vec set[SEARCH_SET_SIZE] = {								\
+		set1(key[0]), set1(key[1]), set1(key[2]), set1(key[3])		\
+	};																\
+	uint32_t i = 0;													\
+	uint32_t mask;													\
+																	\
+	for (; i + VEC_BYTES <= size; i += VEC_BYTES) {					\
+		mask = name##SetMask(buf + i, set, skip);					\
+		if (0 != mask) {											\
+			return (int)(i + __builtin_ctz(mask));					\
+		}															\
+	}																\
+																	\
+	if (i < size) {													\
+		mask = name##SetMask(buf + size - VEC_BYTES, set, skip) >> (VEC_BYTES - (size - i));	\
+		if (0 != mask) {											\
+			return (int)(i + __builtin_ctz(mask));					\
+		}															\
+	}																\
+																	\
+	return -1;														\
+}																	\
+																	\
+attr static int FindSetRev##name(const char *buf, uint32_t size, const char *key, bool skip)	\
+{																	\
+	if (size < VEC_BYTES) {											\
+		return FindSetRev##tail(buf, size, key, skip);				\
+	}																\
+																	\
+	const vec set[SEARCH_SET_SIZE] = {								\
+		set1(key[0]), set1(key[1]), set1(key[2]), set1(key[3])		\
+	};																\
+	uint32_t i = size;												\
+	uint32_t mask;													\
+																	\
+	while (i >= VEC_BYTES) {										\
+		i -= VEC_BYTES;												\
+		mask = name##SetMask(buf + i, set, skip);					\
+		if (0 != mask) {											\
+			return (int)(i + 31 - __builtin_clz(mask));				\
+		}															\
+	}																\
+																	\
+	if (0 != i) {													\
+		mask = name##SetMask(buf, set, skip) & ((1U << i) - 1);		\
+		if (0 != mask) {											\
+			return (int)(31 - __builtin_clz(mask));					\
+		}															\
+	}																\
+																	\
+	return -1;														\
+}
+
+SEARCH_KERNELS(SSE2, Scalar, __attribute__((target("sse2"))), __m128i, 16,
+			   _mm_set1_epi8, _mm_loadu_si128, _mm_cmpeq_epi8,
+			   _mm_and_si128, _mm_or_si128, _mm_movemask_epi8)
+
+SEARCH_KERNELS(AVX2, SSE2, __attribute__((target("avx2"))), __m256i, 32,
+			   _mm256_set1_epi8, _mm256_loadu_si256, _mm256_cmpeq_epi8,
+			   _mm256_and_si256, _mm256_or_si256, _mm256_movemask_epi8)
+
+#undef SEARCH_KERNELS
+
+static const CSearchKernel sSSE2 = {
+	CStringSearch::SSE2,
+	FindCharSSE2,
+	FindCharRevSSE2,
+	FindStrSSE2,
+	FindStrRevSSE2,
+	FindSetSSE2,
+	FindSetRevSSE2,
+};
+
+static const CSearchKernel sAVX2 = {
+	CStringSearch::AVX2,
+	FindCharAVX2,
+	FindCharRevAVX2,
+	FindStrAVX2,
+	FindStrRevAVX2,
+	FindSetAVX2,
+	FindSetRevAVX2,
+};
+
+#endif /* STRING_SEARCH_X86 */
+
+/* =====================================================================
+ *							Dispatch
+ * ===================================================================== */
+static const CSearchKernel *GetBest(CStringSearch::Level level)
+{
+#ifdef STRING_SEARCH_X86
+	__builtin_cpu_init();
+
+	if (level >= CStringSearch::AVX2 && __builtin_cpu_supports("avx2")) {
+		return &sAVX2;
+	}
+
+	if (level >= CStringSearch::SSE2 && __builtin_cpu_supports("sse2")) {
+		return &sSSE2;
+	}
+#else
+	(void)level;
+#endif
+
+	return &sScalar;
+}
+
+/* Chosen at the first call, so it also works
+ * during the static initialization of the other files. */
+static const CSearchKernel *&GetKernel(void)
+{
+	static const CSearchKernel *sKernel = GetBest(CStringSearch::AVX2);
+
+	return sKernel;
+}
+
+int CStringSearch::FindChar(const char *buf, uint32_t size, char ch)
+{
+	return GetKernel()->mFindChar(buf, size, ch);
+}
+
+int CStringSearch::FindCharRev(const char *buf, uint32_t size, char ch)
+{
+	return GetKernel()->mFindCharRev(buf, size, ch);
+}
+
+int CStringSearch::FindStr(const char *buf, uint32_t size,
+						   const char *key, uint32_t ksize)
+{
+	return GetKernel()->mFindStr(buf, size, key, ksize);
+}
+
+int CStringSearch::FindStrRev(const char *buf, uint32_t size,
+							  const char *key, uint32_t ksize)
+{
+	return GetKernel()->mFindStrRev(buf, size, key, ksize);
+}
+
+/* The set is filled up to SEARCH_SET_SIZE with its first char */
+#define SEARCH_SET(name, set, nset)										\
+	char name[SEARCH_SET_SIZE];											\
+	for (uint32_t i = 0; i < SEARCH_SET_SIZE; ++i) {					\
+		name[i] = set[(i < nset) ? i : 0];								\
+	}
+
+int CStringSearch::FindAny(const char *buf, uint32_t size,
+						   const char *set, uint32_t nset)
+{
+	SEARCH_SET(key, set, nset);
+
+	return GetKernel()->mFindSet(buf, size, key, false);
+}
+
+int CStringSearch::FindAnyRev(const char *buf, uint32_t size,
+							  const char *set, uint32_t nset)
+{
+	SEARCH_SET(key, set, nset);
+
+	return GetKernel()->mFindSetRev(buf, size, key, false);
+}
+
+int CStringSearch::SkipAny(const char *buf, uint32_t size,
+						   const char *set, uint32_t nset)
+{
+	SEARCH_SET(key, set, nset);
+
+	return GetKernel()->mFindSet(buf, size, key, true);
+}
+
+int CStringSearch::SkipAnyRev(const char *buf, uint32_t size,
+							  const char *set, uint32_t nset)
+{
+	SEARCH_SET(key, set, nset);
+
+	return GetKernel()->mFindSetRev(buf, size, key, true);
+}
+
+#undef SEARCH_SET
+
+CStringSearch::Level CStringSearch::GetLevel(void)
+{
+	return GetKernel()->mLevel;
+}
+
+void CStringSearch::SetLevel(Level level)
+{
+	GetKernel() = GetBest(level);
+}
@@ -33,14 +33,11 @@ void CStringSplitIter::_Begin(void)
 	mStart = 0;
 
 	/* Find next */
-	for (mEnd = mStart; mEnd <= ssize - ksize; ++mEnd) {
-		if (0 == memcmp(&mSrc[mEnd], mKey, ksize)) {
-			return;
-		}
-	}
+	int pos = CStringSearch::Find(GetBuf(mSrc) + mStart, ssize - mStart,
+								  GetBuf(mKey), ksize);
 
 	/* No match is found */
-	mEnd = ssize;
+	mEnd = (pos < 0) ? ssize : mStart + pos;
 }
 
 void CStringSplitIter::_Next(void)
@@ -71,14 +68,11 @@ void CStringSplitIter::_Next(void)
 	/* mStart <= ssize */
 
 	/* Find next */
-	for (mEnd = mStart; mEnd <= dsize; ++mEnd) {
-		if (0 == memcmp(&mSrc[mEnd], mKey, ksize)) {
-			return;
-		}
-	}
+	int pos = CStringSearch::Find(GetBuf(mSrc) + mStart, ssize - mStart,
+								  GetBuf(mKey), ksize);
 
 	/* No match is found */
-	mEnd = ssize;
+	mEnd = (pos < 0) ? ssize : mStart + pos;
 }
 
 void CStringSplitIter::_Rest(void)
@@ -33,20 +33,7 @@ void CStringSplitRevIter::_Begin(void)
 	}
 
 	/* ssize >= ksize */
-	mStart = ssize - ksize;
-	/* mStart >= 0 */
-
-	while (0 != memcmp(&mSrc[mStart], mKey, ksize)) {
-
-		/* Rest parts are all not matched. */
-		if (0 == mStart) {
-			return;
-		}
-
-		--mStart;
-	}
-
-	mStart += ksize;
+	Search();
 }
 
 void CStringSplitRevIter::_Next(void)
@@ -71,20 +58,7 @@ void CStringSplitRevIter::_Next(void)
 	}
 
 	/* mEnd >= ksize */
-	mStart = mEnd - ksize;
-	/* mStart >= 0 */
-
-	while (0 != memcmp(&mSrc[mStart], mKey, ksize)) {
-
-		/* Rest parts are all not matched. */
-		if (0 == mStart) {
-			return;
-		}
-
-		--mStart;
-	}
-
-	mStart += ksize;
+	Search();
 }
 
 void CStringSplitRevIter::_Rest(void)
@@ -110,3 +84,12 @@ CString::IteratorPtr CStringSplitRevIter::_Reverse(void)
 	return CStringSplitIterPtr(mSrc, mKey);
 }
 
+void CStringSplitRevIter::Search(void)
+{
+	int pos = CStringSearch::FindRev(GetBuf(mSrc), mEnd,
+									 GetBuf(mKey), mKey->GetSize());
+
+	/* Rest parts are all not matched. */
+	mStart = (pos < 0) ? 0 : pos + mKey->GetSize();
+}
+
@@ -36,6 +36,10 @@ private:
 	virtual void _Next(void);
 	virtual void _Rest(void);
 	virtual CString::IteratorPtr _Reverse(void);
+
+private:
+	/* Find the last match before mEnd, mStart -> next to the match */
+	void Search(void);
 };
 
 inline CStringSplitRevIter::CStringSplitRevIter(const CConstStringPtr &src,
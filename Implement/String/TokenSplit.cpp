@@ -19,108 +19,74 @@
 
 void CTokenSplitIter::_Begin(void)
 {
-	uint32_t size = mSrc->GetSize();
-
-	if (size == 0) {
+	if (0 == mSrc->GetSize()) {
 		SetEnd();
 		return;
 	}
 
 	mIsEnd = false;
-	mEnd = 0;
-
-	/* Ignore the continuous match */
-	while (Match(mSrc[mEnd])) {
-		/* Last character that matches */
-		if (mEnd == size - 1) {
-			SetEnd();
-			return;
-		}
-
-		++mEnd;
-	}
-
-	/* This is the first non-matched character */
-	mStart = mEnd;
-
-	/* Find the end of the non-match */
-	for (++mEnd; mEnd < size; ++mEnd) {
-		if (Match(mSrc[mEnd])) {
-			return;
-		}
-	}
+	Split(0, false);
 }
 
 void CTokenSplitIter::_Next(void)
 {
 	uint32_t size = mSrc->GetSize();
-	uint32_t last = size - 1;
 
 	/* size == mEnd:     Previous entity is the last entity.
-	 * size == mEnd - 1: Last character got match. */
-	if (mEnd >= last) {
+	 * size == mEnd + 1: Last character got match. */
+	if (mEnd + 1 >= size) {
 		SetEnd();
 		return;
 	}
 
-	/* mEnd < size - 1 */
-	++mEnd;
-	/* mEnd < size */
-
-	/* Ignore the continuous match */
-	while (Match(mSrc[mEnd])) {
-		/* Last character that matches */
-		if (mEnd == last) {
-			SetEnd();
-			return;
-		}
-
-		++mEnd;
-	}
-
-	mStart = mEnd;
-
-	/* Find the end of the non-match */
-	for (++mEnd; mEnd < size; ++mEnd) {
-		if (Match(mSrc[mEnd])) {
-			return;
-		}
-	}
+	Split(mEnd + 1, false);
 }
 
 void CTokenSplitIter::_Rest(void)
 {
 	uint32_t size = mSrc->GetSize();
-	uint32_t last = size - 1;
 
 	/* size == mEnd:     Previous entity is the last entity.
-	 * size == mEnd - 1: Last character got match. */
-	if (mEnd >= last) {
+	 * size == mEnd + 1: Last character got match. */
+	if (mEnd + 1 >= size) {
 		SetEnd();
 		return;
 	}
 
-	/* mEnd < size - 1 */
-	++mEnd;
-	/* mEnd < size */
+	Split(mEnd + 1, true);
+}
+
+CString::IteratorPtr CTokenSplitIter::_Reverse(void)
+{
+	return CTokenSplitRevIterPtr(mSrc);
+}
+
+void CTokenSplitIter::Split(uint32_t pos, bool rest)
+{
+	const char *src = GetBuf(mSrc);
+	uint32_t size = mSrc->GetSize();
 
 	/* Ignore the continuous match */
-	while (Match(mSrc[mEnd])) {
-		/* Last character that matches */
-		if (mEnd == last) {
-			SetEnd();
-			return;
-		}
-
-		++mEnd;
+	int start = CStringSearch::SkipAny(src + pos, size - pos,
+									   TOKEN_SPLIT_SET, TOKEN_SPLIT_SET_SIZE);
+	if (start < 0) {
+		SetEnd();
+		return;
 	}
 
-	mStart = mEnd;
+	/* This is the first non-matched character */
+	mStart = pos + start;
 	mEnd = size;
-}
 
-CString::IteratorPtr CTokenSplitIter::_Reverse(void)
-{
-	return CTokenSplitRevIterPtr(mSrc);
+	if (rest) {
+		return;
+	}
+
+	/* Find the end of the non-match */
+	int end = CStringSearch::FindAny(src + mStart + 1, size - mStart - 1,
+									 TOKEN_SPLIT_SET, TOKEN_SPLIT_SET_SIZE);
+	if (end >= 0) {
+		mEnd = mStart + 1 + end;
+	}
 }
 
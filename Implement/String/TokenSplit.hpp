@@ -19,6 +19,10 @@
 
 #include <EasyCpp.hpp>
 
+/* The characters splitting the tokens */
+#define TOKEN_SPLIT_SET " \t\r\n"
+#define TOKEN_SPLIT_SET_SIZE 4
+
 DEFINE_CLASS(TokenSplitIter);
 
 class CTokenSplitIter :
@@ -34,7 +38,9 @@ private:
 	virtual CString::IteratorPtr _Reverse(void);
 
 private:
-	inline bool Match(char ch);
+	/* Split the token starting from pos.
+	 * rest: the token runs to the end of the string. */
+	void Split(uint32_t pos, bool rest);
 };
 
 inline CTokenSplitIter::CTokenSplitIter(const CConstStringPtr &src) :
@@ -43,11 +49,5 @@ inline CTokenSplitIter::CTokenSplitIter(const CConstStringPtr &src) :
 	/* Does nothing */
 }
 
-inline bool CTokenSplitIter::Match(char ch)
-{
-	return ch == ' ' || ch == '\t' ||
-		ch == '\r' || ch == '\n';
-}
-
 #endif /* __TOKEN_SPLIT_HPP__ */
 
@@ -20,7 +20,6 @@
 void CTokenSplitRevIter::_Begin(void)
 {
 	uint32_t size = mSrc->GetSize();
-	uint32_t tmp;
 
 	if (0 == size) {
 		SetEnd();
@@ -28,44 +27,11 @@ void CTokenSplitRevIter::_Begin(void)
 	}
 
 	mIsEnd = false;
-	mEnd = size;
-	tmp = mEnd - 1;
-
-	/* Ignore the continuous match */
-	while (Match(mSrc[tmp])) {
-		/* Last character matches */
-		if (0 == tmp) {
-			SetEnd();
-			return;
-		}
-
-		mEnd = tmp;
-		tmp = mEnd - 1;
-	}
-
-	/* mEnd -> next to the 1st non-match */
-	mStart = mEnd - 1;
-	/* mStart -> 1st non-match */
-
-	/* Find the 2nd match */
-	while (mStart > 0) {
-		tmp = mStart - 1;
-
-		if (Match(mSrc[tmp])) {
-			/* [mStart, mEnd] is splitted */
-			return;
-		}
-
-		mStart = tmp;
-	}
-
-	/* [0, mEnd] is splitted */
+	Split(size, false);
 }
 
 void CTokenSplitRevIter::_Next(void)
 {
-	uint32_t tmp;
-
 	/* mStart == 0: Previous entity is the last entity.
 	 * mStart == 1: src[0] matches. */
 	if (mStart <= 1) {
@@ -73,50 +39,12 @@ void CTokenSplitRevIter::_Next(void)
 		return;
 	}
 
-	/* mStart > 1.
-	 * mStart -> next to the 1st match. */
-	mEnd = mStart - 1;
-	/* mEnd > 0.
-	 * mEnd -> 1st match */
-	tmp = mEnd - 1;
-	/* tmp >= 0.
-	 * tmp -> prev to the 1st match. */
-
-	/* Ignore the continuous match */
-	while (Match(mSrc[tmp])) {
-		/* Last character matches */
-		if (0 == tmp) {
-			SetEnd();
-			return;
-		}
-
-		mEnd = tmp;
-		tmp = mEnd - 1;
-	}
-
-	/* mEnd -> next to the 1st non-match */
-	mStart = mEnd - 1;
-	/* mStart -> 1st non-match */
-
-	/* Find the 2nd match */
-	while (mStart > 0) {
-		tmp = mStart - 1;
-
-		if (Match(mSrc[tmp])) {
-			/* [mStart, mEnd] is splitted */
-			return;
-		}
-
-		mStart = tmp;
-	}
-
-	/* [0, mEnd] is splitted */
+	/* mStart - 1 -> 1st match */
+	Split(mStart - 1, false);
 }
 
 void CTokenSplitRevIter::_Rest(void)
 {
-	uint32_t tmp;
-
 	/* mStart == 0: Previous entity is the last entity.
 	 * mStart == 1: src[0] matches. */
 	if (mStart <= 1) {
@@ -124,33 +52,33 @@ void CTokenSplitRevIter::_Rest(void)
 		return;
 	}
 
-	/* mStart > 1.
-	 * mStart -> next to the 1st match. */
-	mEnd = mStart - 1;
-	/* mEnd > 0.
-	 * mEnd -> 1st match */
-	tmp = mEnd - 1;
-	/* tmp >= 0.
-	 * tmp -> prev to the 1st match. */
+	/* mStart - 1 -> 1st match */
+	Split(mStart - 1, true);
+}
 
-	/* Ignore the continuous match */
-	while (Match(mSrc[tmp])) {
-		/* Last character matches */
-		if (0 == tmp) {
-			SetEnd();
-			return;
-		}
+CString::IteratorPtr CTokenSplitRevIter::_Reverse(void)
+{
+	return CTokenSplitIterPtr(mSrc);
+}
 
-		mEnd = tmp;
-		tmp = mEnd - 1;
+void CTokenSplitRevIter::Split(uint32_t pos, bool rest)
+{
+	const char *src = GetBuf(mSrc);
+
+	/* Ignore the continuous match */
+	int last = CStringSearch::SkipAnyRev(src, pos,
+										 TOKEN_SPLIT_SET, TOKEN_SPLIT_SET_SIZE);
+	if (last < 0) {
+		SetEnd();
+		return;
 	}
 
 	/* mEnd -> next to the 1st non-match */
-	mStart = 0;
-}
+	mEnd = last + 1;
 
-CString::IteratorPtr CTokenSplitRevIter::_Reverse(void)
-{
-	return CTokenSplitIterPtr(mSrc);
+	/* Find the 2nd match, [0, mEnd] is splitted if none */
+	mStart = rest ? 0 :
+		CStringSearch::FindAnyRev(src, last,
+								  TOKEN_SPLIT_SET, TOKEN_SPLIT_SET_SIZE) + 1;
 }
 
@@ -34,7 +34,9 @@ private:
 	virtual CString::IteratorPtr _Reverse(void);
 
 private:
-	inline bool Match(char ch);
+	/* Split the token ending before pos.
+	 * rest: the token runs to the beginning of the string. */
+	void Split(uint32_t pos, bool rest);
 };
 
 inline CTokenSplitRevIter::CTokenSplitRevIter(const CConstStringPtr &src) :
@@ -43,11 +45,5 @@ inline CTokenSplitRevIter::CTokenSplitRevIter(const CConstStringPtr &src) :
 	/* Does nothing */
 }
 
-inline bool CTokenSplitRevIter::Match(char ch)
-{
-	return ch == ' ' || ch == '\t' ||
-		ch == '\r' || ch == '\n';
-}
-
 #endif /* __TOKEN_SPLIT_REV_HPP__ */
 
@@ -72,19 +72,25 @@ public:
 		return false;
 	}
 
+	/* The iterator is shared once for the whole loop,
+	 * not once per element. */
 	DEFINE_FUNC(VoidIterShare, void(const T &, const Tn & ..., const CSharedPtr<Base> &));
 	inline void ForEach(const VoidIterShareFn &fn)
 	{
+		auto self(CEnableSharedPtr<Base>::Share());
+
 		for (__Begin(); !__End(); __Next()) {
-			Get(fn, CEnableSharedPtr<Base>::Share());
+			Get(fn, self);
 		}
 	}
 
 	DEFINE_FUNC(BoolIterShare, ForEachControl(const T &, const Tn & ..., const CSharedPtr<Base> &));
 	inline bool ForEach(const BoolIterShareFn &fn)
 	{
+		auto self(CEnableSharedPtr<Base>::Share());
+
 		for (__Begin(); !__End(); __Next()) {
-			if (BREAK == Get(fn, CEnableSharedPtr<Base>::Share())) {
+			if (BREAK == Get(fn, self)) {
 				return true;
 			}
 		}
@@ -142,13 +148,15 @@ public:
 
 	inline CSharedPtr<Base> First(const VoidIterShareFn &fn)
 	{
+		auto self(CEnableSharedPtr<Base>::Share());
+
 		__Begin();
 
 		if (!__End()) {
-			Get(fn, CEnableSharedPtr<Base>::Share());
+			Get(fn, self);
 		}
 
-		return CEnableSharedPtr<Base>::Share();
+		return self;
 	}
 
 	template <class Fn,
@@ -197,11 +205,13 @@ public:
 
 	inline CSharedPtr<Base> Next(const VoidIterShareFn &fn)
 	{
+		auto self(CEnableSharedPtr<Base>::Share());
+
 		__Next();
 		if (!__End()) {
-			Get(fn, CEnableSharedPtr<Base>::Share());
+			Get(fn, self);
 		}
-		return CEnableSharedPtr<Base>::Share();
+		return self;
 	}
 
 	template <class Fn,
@@ -269,15 +279,19 @@ public:
 
 	inline void RestEach(const VoidIterShareFn &fn)
 	{
+		auto self(CEnableSharedPtr<Base>::Share());
+
 		for (__Next(); !__End(); __Next()) {
-			Get(fn, CEnableSharedPtr<Base>::Share());
+			Get(fn, self);
 		}
 	}
 
 	inline bool RestEach(const BoolIterShareFn &fn)
 	{
+		auto self(CEnableSharedPtr<Base>::Share());
+
 		for (__Next(); !__End(); __Next()) {
-			if (BREAK == Get(fn, CEnableSharedPtr<Base>::Share())) {
+			if (BREAK == Get(fn, self)) {
 				return true;
 			}
 		}
@@ -306,8 +320,10 @@ public:
 	->decltype(std::declval<Fn>()(std::declval<T>(), std::declval<Tn>()...,
 								  CEnableSharedPtr<Base>::Share()))
 	{
+		auto self(CEnableSharedPtr<Base>::Share());
+
 		for (__Next(); !__End(); __Next()) {
-			auto tmp(Get(fn, CEnableSharedPtr<Base>::Share()));
+			auto tmp(Get(fn, self));
 			if (tmp) {
 				return tmp;
 			}
@@ -17,20 +17,45 @@
 #ifndef __SLIST_HPP__
 #define __SLIST_HPP__
 
+#include <Os.hpp>
 #include <Atomic.hpp>
 #include <Common/Typedef.hpp>
 
-#ifdef BIT32
-#define CNT			(0x0000000100000000UL)
-#define CNT_MASK	(0xFFFFFFFF00000000UL)
+class SList;
+
+#ifdef ATOMIC_HAS_CAS128
+
+/* The head is the pointer and a 64 bits tag swapped together
+ * by a double width CAS. The pointer keeps all its bits and
+ * the tag does not wrap in practice. */
+struct alignas(16) SListHead
+{
+	SList *mPtr;
+	uint64_t mTag;
+};
+
 #else
-#define CNT			(0x0001000000000000UL)
-#define CNT_MASK	(0xFFFF000000000000UL)
+
+/* Without double width CAS, the tag is kept in the unused top
+ * bits of the pointer. On 32 bits the pointer takes the low
+ * half and the tag the high half. On 64 bits it depends on the
+ * virtual address width: 48 bits leaves a 16 bits tag, define
+ * SLIST_ADDR_BITS to 57 for 5-level paging (a 7 bits tag). */
+typedef uint64_t SListHead;
+
+#ifdef BIT32
+#define SLIST_ADDR_BITS 32
+#elif !defined(SLIST_ADDR_BITS)
+#define SLIST_ADDR_BITS 48
 #endif
 
+#define CNT			(1ULL << SLIST_ADDR_BITS)
+#define CNT_MASK	(~(CNT - 1))
+
 #define GET_ADDR(pData) (((uint64_t)(pData)) & (~(CNT_MASK)))
 #define GET_CNT(pData) (((uint64_t)(pData)) & CNT_MASK)
-#define INC_CNT(pData) (GET_CNT(pData) + CNT)
+
+#endif
 
 class SList {
 public:
@@ -40,35 +65,121 @@ public:
 		/* Does nothing */
 	}
 
-	inline static void Push(uint64_t *pHead, SList *pNode)
+	/* The failed CAS are counted in pRetry if it is given. */
+	inline static void Push(SListHead *pHead, SList *pNode,
+							uint32_t *pRetry = nullptr)
+	{
+		PushChain(pHead, pNode, pNode, pRetry);
+	}
+
+	/* Push the nodes from pFirst to pLast, linked by mNext. */
+	inline static void PushChain(SListHead *pHead, SList *pFirst, SList *pLast,
+								 uint32_t *pRetry = nullptr)
 	{
 		do {
-			uint64_t tmp = *pHead;
-			pNode->mNext = (SList *)GET_ADDR(tmp);
-			uint64_t pNewHead = ((uint64_t)(pNode)) | INC_CNT(tmp);
-			if (ATOMIC_COMPARE_AND_SWAP64(pHead, tmp, pNewHead))
+			SListHead tmp = *pHead;
+			pLast->mNext = GetPtr(tmp);
+			if (CompareAndSwap(pHead, tmp, MakeHead(pFirst, GetTag(tmp) + 1)))
 				return;
+
+			Retry(pRetry);
 		} while (true);
 	}
 
-	inline static SList *Pop(uint64_t *pHead)
+	inline static SList *Pop(SListHead *pHead, uint32_t *pRetry = nullptr)
 	{
 		do {
-			uint64_t tmp = *pHead;
-			SList *pNode = (SList *)GET_ADDR(tmp);
+			SListHead tmp = *pHead;
+			SList *pNode = GetPtr(tmp);
 			if (nullptr == pNode)
 				return nullptr;
 
-			uint64_t pNewHead = ((uint64_t)(pNode->mNext)) | GET_CNT(tmp);
+			if (CompareAndSwap(pHead, tmp, MakeHead(pNode->mNext, GetTag(tmp))))
+				return pNode;
+
+			Retry(pRetry);
+		} while (true);
+	}
+
+	/* Detach the whole list, the nodes are still linked by mNext. */
+	inline static SList *PopAll(SListHead *pHead)
+	{
+		do {
+			SListHead tmp = *pHead;
+			SList *pNode = GetPtr(tmp);
+			if (nullptr == pNode)
+				return nullptr;
 
-			if (ATOMIC_COMPARE_AND_SWAP64(pHead, tmp, pNewHead))
+			if (CompareAndSwap(pHead, tmp, MakeHead(nullptr, GetTag(tmp))))
 				return pNode;
 		} while (true);
 	}
 
+	/* The first node, only for debugging */
+	inline static SList *Peek(const SListHead *pHead)
+	{
+		return GetPtr(*pHead);
+	}
+
+private:
+	inline static void Retry(uint32_t *pRetry)
+	{
+		if (nullptr != pRetry) {
+			ATOMIC_ADD_AND_FETCH(pRetry, 1);
+		}
+	}
+
+#ifdef ATOMIC_HAS_CAS128
+	inline static SList *GetPtr(const SListHead &head)
+	{
+		return head.mPtr;
+	}
+
+	inline static uint64_t GetTag(const SListHead &head)
+	{
+		return head.mTag;
+	}
+
+	inline static SListHead MakeHead(SList *pNode, uint64_t tag)
+	{
+		SListHead head = {pNode, tag};
+
+		return head;
+	}
+
+	/* The 2 words of tmp may be read at different time,
+	 * the CAS fails then and it is read again. */
+	inline static bool CompareAndSwap(SListHead *pHead, const SListHead &tmp,
+									  const SListHead &head)
+	{
+		return ATOMIC_COMPARE_AND_SWAP128(pHead,
+			ATOMIC_MAKE128(tmp.mPtr, tmp.mTag),
+			ATOMIC_MAKE128(head.mPtr, head.mTag));
+	}
+#else
+	inline static SList *GetPtr(SListHead head)
+	{
+		return (SList *)GET_ADDR(head);
+	}
+
+	inline static uint64_t GetTag(SListHead head)
+	{
+		return GET_CNT(head) >> SLIST_ADDR_BITS;
+	}
+
+	inline static SListHead MakeHead(SList *pNode, uint64_t tag)
+	{
+		return (uint64_t)(uintptr_t)pNode | (tag << SLIST_ADDR_BITS);
+	}
+
+	inline static bool CompareAndSwap(SListHead *pHead, SListHead tmp, SListHead head)
+	{
+		return ATOMIC_COMPARE_AND_SWAP64(pHead, tmp, head);
+	}
+#endif
+
 private:
 	SList *mNext;
 };
 
 #endif /* __SLIST_HPP__ */
-
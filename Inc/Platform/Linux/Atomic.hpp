@@ -25,5 +25,43 @@
 
 typedef unsigned short atomic_t;
 
+/* The macros above are full barriers. These take the memory order:
+ * ATOMIC_RELAXED, ATOMIC_ACQUIRE, ATOMIC_RELEASE, ATOMIC_ACQ_REL
+ * or ATOMIC_SEQ_CST. The CAS takes one for success and one for failure. */
+#define ATOMIC_RELAXED __ATOMIC_RELAXED
+#define ATOMIC_ACQUIRE __ATOMIC_ACQUIRE
+#define ATOMIC_RELEASE __ATOMIC_RELEASE
+#define ATOMIC_ACQ_REL __ATOMIC_ACQ_REL
+#define ATOMIC_SEQ_CST __ATOMIC_SEQ_CST
+
+#define ATOMIC_LOAD_EXPLICIT(a, order) __atomic_load_n(a, order)
+#define ATOMIC_STORE_EXPLICIT(a, b, order) __atomic_store_n(a, b, order)
+#define ATOMIC_ADD_AND_FETCH_EXPLICIT(a, b, order) __atomic_add_fetch(a, b, order)
+#define ATOMIC_SUB_AND_FETCH_EXPLICIT(a, b, order) __atomic_sub_fetch(a, b, order)
+#define ATOMIC_COMPARE_AND_SWAP_EXPLICIT(a, b, c, success, failure) \
+	AtomicCompareAndSwapExplicit(a, b, c, success, failure)
+#define ATOMIC_FENCE(order) __atomic_thread_fence(order)
+
+template <class T, class V>
+static inline bool AtomicCompareAndSwapExplicit(T *a, V b, V c, int success, int failure)
+{
+	T expected = (T)b;
+
+	return __atomic_compare_exchange_n(a, &expected, (T)c, false, success, failure);
+}
+
+/* Double width CAS (cmpxchg16b), needs -mcx16 on x86_64.
+ * b and c are made by ATOMIC_MAKE128(low, high). */
+#ifdef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_16
+#define ATOMIC_HAS_CAS128
+
+typedef unsigned __int128 atomic128_t;
+
+#define ATOMIC_MAKE128(lo, hi) \
+	((((atomic128_t)(uint64_t)(hi)) << 64) | (atomic128_t)(uint64_t)(lo))
+#define ATOMIC_COMPARE_AND_SWAP128(a, b, c) \
+	__sync_bool_compare_and_swap((atomic128_t *)(a), b, c)
+#endif
+
 #endif /* __ATOMIC_HPP__ */
 
@@ -17,11 +17,16 @@
 #ifndef __OS_HPP__
 #define __OS_HPP__
 
+#include <sys/uio.h>
+
 #if __x86_64__
 #define BIT64
 #else
 #define BIT32
 #endif
 
+/* Index of the highest set bit, x must not be 0 */
+#define BIT_SCAN_REVERSE(x) (31 - __builtin_clz(x))
+
 #endif /* __OS_HPP__ */
 
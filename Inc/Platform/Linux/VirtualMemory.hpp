@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __VIRTUAL_MEMORY_HPP__
+#define __VIRTUAL_MEMORY_HPP__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+#define OS_PAGE_SIZE (4096)
+#define OS_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/* Map size bytes of zero-filled memory aligned to align.
+ * align must be a power of 2 and a multiple of OS_PAGE_SIZE.
+ * Returns nullptr on failure. */
+static inline void *VirtualMapAligned(size_t size, size_t align)
+{
+	size_t len = size + align;
+	char *ptr = (char *)mmap(nullptr, len, PROT_READ | PROT_WRITE,
+							 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (MAP_FAILED == ptr) {
+		return nullptr;
+	}
+
+	char *ret = (char *)(((uintptr_t)ptr + align - 1) & ~(uintptr_t)(align - 1));
+
+	if (ret != ptr) {
+		munmap(ptr, ret - ptr);
+	}
+
+	if (ret + size != ptr + len) {
+		munmap(ret + size, (ptr + len) - (ret + size));
+	}
+
+	return ret;
+}
+
+/* Same as VirtualMapAligned, but backed by huge pages if possible.
+ * size and align must be multiples of OS_HUGE_PAGE_SIZE.
+ * It tries hugetlbfs pages first, then falls back to normal pages
+ * with transparent huge pages requested. */
+static inline void *VirtualMapHuge(size_t size, size_t align)
+{
+#ifdef MAP_HUGETLB
+	size_t len = size + align - OS_HUGE_PAGE_SIZE;
+	char *ptr = (char *)mmap(nullptr, len, PROT_READ | PROT_WRITE,
+							 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+	if (MAP_FAILED != ptr) {
+		/* Huge pages are always aligned to OS_HUGE_PAGE_SIZE,
+		 * so the trimmed parts are whole huge pages. */
+		char *ret = (char *)(((uintptr_t)ptr + align - 1) & ~(uintptr_t)(align - 1));
+
+		if (ret != ptr) {
+			munmap(ptr, ret - ptr);
+		}
+
+		if (ret + size != ptr + len) {
+			munmap(ret + size, (ptr + len) - (ret + size));
+		}
+
+		return ret;
+	}
+#endif
+
+	void *ret = VirtualMapAligned(size, align);
+
+#ifdef MADV_HUGEPAGE
+	if (nullptr != ret) {
+		madvise(ret, size, MADV_HUGEPAGE);
+	}
+#endif
+
+	return ret;
+}
+
+/* Give the physical pages back to the OS but keep the range mapped.
+ * Reading it stays safe (it reads as zeros) and writing commits
+ * the pages again. False if the OS refused, the pages are kept. */
+static inline bool VirtualDecommit(void *ptr, size_t size)
+{
+	return 0 == madvise(ptr, size, MADV_DONTNEED);
+}
+
+/* Nothing to do, the pages are committed again when written. */
+static inline bool VirtualCommit(void *, size_t)
+{
+	return true;
+}
+
+#endif /* __VIRTUAL_MEMORY_HPP__ */
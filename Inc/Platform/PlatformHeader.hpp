@@ -20,6 +20,7 @@
 #include <Os.hpp>
 #include <Atomic.hpp>
 #include <Demangle.hpp>
+#include <VirtualMemory.hpp>
 
 #endif /* __PLATFORM_HEADER_HPP__ */
 
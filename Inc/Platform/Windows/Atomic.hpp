@@ -34,5 +34,62 @@
 
 typedef unsigned short atomic_t;
 
+/* The Interlocked functions are full barriers,
+ * the memory order is only used by the Linux version. */
+#define ATOMIC_RELAXED 0
+#define ATOMIC_ACQUIRE 2
+#define ATOMIC_RELEASE 3
+#define ATOMIC_ACQ_REL 4
+#define ATOMIC_SEQ_CST 5
+
+#define ATOMIC_LOAD_EXPLICIT(a, order) AtomicLoadExplicit(a)
+#define ATOMIC_STORE_EXPLICIT(a, b, order) AtomicStoreExplicit(a, b)
+#define ATOMIC_ADD_AND_FETCH_EXPLICIT(a, b, order) ATOMIC_ADD_AND_FETCH(a, b)
+#define ATOMIC_SUB_AND_FETCH_EXPLICIT(a, b, order) ATOMIC_SUB_AND_FETCH(a, b)
+#define ATOMIC_COMPARE_AND_SWAP_EXPLICIT(a, b, c, success, failure) \
+	ATOMIC_COMPARE_AND_SWAP(a, b, c)
+#define ATOMIC_FENCE(order) MemoryBarrier()
+
+/* Through volatile, so a spin on it is not hoisted out of the loop */
+template <class T>
+static inline T AtomicLoadExplicit(T *a)
+{
+	T val = *(volatile T *)a;
+
+	MemoryBarrier();
+	return val;
+}
+
+template <class T, class V>
+static inline void AtomicStoreExplicit(T *a, V b)
+{
+	MemoryBarrier();
+	*(volatile T *)a = (T)b;
+}
+
+/* Double width CAS (cmpxchg16b).
+ * b and c are made by ATOMIC_MAKE128(low, high). */
+#ifdef _WIN64
+#define ATOMIC_HAS_CAS128
+
+struct atomic128_t
+{
+	__int64 lo;
+	__int64 hi;
+};
+
+static inline atomic128_t ATOMIC_MAKE128(uint64_t lo, uint64_t hi)
+{
+	atomic128_t ret = {(__int64)lo, (__int64)hi};
+
+	return ret;
+}
+
+static inline bool ATOMIC_COMPARE_AND_SWAP128(volatile void *a, atomic128_t b, atomic128_t c)
+{
+	return 0 != InterlockedCompareExchange128((volatile __int64 *)a, c.hi, c.lo, &b.lo);
+}
+#endif
+
 #endif /* __ATOMIC_HPP__ */
 
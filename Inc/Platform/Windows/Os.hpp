@@ -29,5 +29,22 @@
 #define BIT64
 #endif
 
+/* Index of the highest set bit, x must not be 0 */
+static inline uint32_t BIT_SCAN_REVERSE(uint32_t x)
+{
+	unsigned long idx;
+
+	_BitScanReverse(&idx, x);
+
+	return idx;
+}
+
+/* Same layout as the POSIX one, for the scatter-gather exports */
+struct iovec
+{
+	void *iov_base;
+	size_t iov_len;
+};
+
 #endif /* __OS_HPP__ */
 
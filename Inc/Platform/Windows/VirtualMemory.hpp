@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __VIRTUAL_MEMORY_HPP__
+#define __VIRTUAL_MEMORY_HPP__
+
+#include "Os.hpp"
+
+#define OS_PAGE_SIZE (4096)
+#define OS_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/* Map size bytes of zero-filled memory aligned to align.
+ * align must be a power of 2 and a multiple of OS_PAGE_SIZE.
+ * Returns nullptr on failure. */
+static inline void *VirtualMapAligned(size_t size, size_t align)
+{
+	do {
+		char *ptr = (char *)VirtualAlloc(nullptr, size + align,
+										 MEM_RESERVE, PAGE_NOACCESS);
+
+		if (nullptr == ptr) {
+			return nullptr;
+		}
+
+		/* Windows can not release part of a reservation, so release
+		 * all of it and map again at the aligned address. It may be
+		 * taken by another thread in the meantime, then retry. */
+		VirtualFree(ptr, 0, MEM_RELEASE);
+
+		char *ret = (char *)(((uintptr_t)ptr + align - 1) & ~(uintptr_t)(align - 1));
+
+		ret = (char *)VirtualAlloc(ret, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+		if (nullptr != ret) {
+			return ret;
+		}
+	} while (true);
+}
+
+/* Large pages need SeLockMemoryPrivilege and can not be decommitted,
+ * so normal pages are used on Windows. */
+static inline void *VirtualMapHuge(size_t size, size_t align)
+{
+	return VirtualMapAligned(size, align);
+}
+
+/* Decommitted pages fault when they are touched, the users must
+ * make sure nobody reads them until VirtualCommit() is called. */
+#define VIRTUAL_DECOMMIT_FAULTS
+
+/* Give the physical pages and the commit charge back to the OS,
+ * the range stays reserved. False if the OS refused. */
+static inline bool VirtualDecommit(void *ptr, size_t size)
+{
+	return 0 != VirtualFree(ptr, size, MEM_DECOMMIT);
+}
+
+/* Commit a decommitted range again, it reads as zeros.
+ * Committed pages in the range are left as they are. */
+static inline bool VirtualCommit(void *ptr, size_t size)
+{
+	return nullptr != VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE);
+}
+
+#endif /* __VIRTUAL_MEMORY_HPP__ */
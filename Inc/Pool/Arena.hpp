@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __ARENA_HPP__
+#define __ARENA_HPP__
+
+#include <type_traits>
+#include <Common/Typedef.hpp>
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+#define ARENA_ALIGN 16
+
+/* Bump allocator for the objects living for one request.
+ * Nothing is freed one by one, Reset() drops everything at once.
+ *
+ * While a CArenaScope is alive, the string buffers and the
+ * is_arena_object types made by MakeShared() in the calling
+ * thread are allocated from its arena with no-op deleters: the
+ * destructors are never called. No CSharedPtr to them may be
+ * used after Reset(). */
+class CArena
+{
+public:
+	inline CArena(uint32_t blockSize = ARENA_BLOCK_SIZE);
+	inline ~CArena(void);
+
+	/* Allocate size bytes aligned to ARENA_ALIGN */
+	inline char *Alloc(uint32_t size);
+
+	/* Drop all the allocations. The first block is kept. */
+	inline void Reset(void);
+
+	/* Bytes allocated since the last Reset() */
+	inline uint64_t GetUsed(void) const;
+
+	/* The arena of the calling thread, nullptr if none */
+	inline static CArena *Current(void);
+
+	/* No-op deleters for the CSharedPtr in the arena */
+	inline static void Release(char *) {}
+	inline static void Destroy(void *) {}
+
+private:
+	struct CArenaBlock
+	{
+		CArenaBlock *mNext;
+		uint32_t mSize;
+	};
+
+	inline char *NewBlock(uint32_t size, bool aside);
+	inline static CArena *&GetCurrent(void);
+
+	friend class CArenaScope;
+
+private:
+	CArenaBlock *mBlocks;
+	char *mPos;
+	char *mEnd;
+	uint32_t mBlockSize;
+	uint64_t mUsed;
+
+	inline CArena(const CArena &);
+	inline CArena &operator = (const CArena &);
+};
+
+/* Types MakeShared() creates in the current arena. Their
+ * destructor is never called, so by default only the trivially
+ * destructible ones. A type may opt in by specializing it only
+ * if nothing it holds lives outside the arena. CString and CJson
+ * do not: a slice shares the buffer of its source, which may
+ * have been made before the scope. Use MakeArenaShared() to put
+ * such an object in the arena explicitly. */
+template <class T>
+struct is_arena_object :
+	std::is_trivially_destructible<T> {};
+
+/* Makes arena the arena of the calling thread
+ * until it goes out of scope. Scopes can be nested. */
+class CArenaScope
+{
+public:
+	inline CArenaScope(CArena &arena) :
+		mPrev(CArena::GetCurrent())
+	{
+		CArena::GetCurrent() = &arena;
+	}
+
+	inline ~CArenaScope(void)
+	{
+		CArena::GetCurrent() = mPrev;
+	}
+
+private:
+	CArena *mPrev;
+};
+
+/* =====================================================================
+ *							Implement CArena
+ * ===================================================================== */
+#define ARENA_HEADER \
+	((sizeof(CArenaBlock) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+inline CArena::CArena(uint32_t blockSize) :
+	mBlocks(nullptr),
+	mPos(nullptr),
+	mEnd(nullptr),
+	mBlockSize(blockSize),
+	mUsed(0)
+{
+	/* Does nothing */
+}
+
+inline CArena::~CArena(void)
+{
+	while (nullptr != mBlocks) {
+		CArenaBlock *next = mBlocks->mNext;
+
+		delete [] (char *)mBlocks;
+		mBlocks = next;
+	}
+}
+
+inline char *CArena::Alloc(uint32_t size)
+{
+	size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+	mUsed += size;
+
+	if (size > (uint32_t)(mEnd - mPos)) {
+		/* A big buffer gets its own block, so
+		 * the rest of the current one is not wasted. */
+		if (size > (mBlockSize >> 2) && nullptr != mBlocks) {
+			return NewBlock(size, true);
+		}
+
+		mPos = NewBlock(size > mBlockSize ? size : mBlockSize, false);
+		mEnd = (char *)mBlocks + mBlocks->mSize;
+	}
+
+	char *ret = mPos;
+	mPos += size;
+
+	return ret;
+}
+
+inline void CArena::Reset(void)
+{
+	if (nullptr == mBlocks) {
+		return;
+	}
+
+	/* Keep the last block, it is the first one allocated */
+	while (nullptr != mBlocks->mNext) {
+		CArenaBlock *next = mBlocks->mNext;
+
+		delete [] (char *)mBlocks;
+		mBlocks = next;
+	}
+
+	mPos = (char *)mBlocks + ARENA_HEADER;
+	mEnd = (char *)mBlocks + mBlocks->mSize;
+	mUsed = 0;
+}
+
+inline uint64_t CArena::GetUsed(void) const
+{
+	return mUsed;
+}
+
+inline CArena *CArena::Current(void)
+{
+	return GetCurrent();
+}
+
+inline CArena *&CArena::GetCurrent(void)
+{
+	static thread_local CArena *sCurrent = nullptr;
+
+	return sCurrent;
+}
+
+/* A block put aside is linked after the current one,
+ * so the current one is still used. */
+inline char *CArena::NewBlock(uint32_t size, bool aside)
+{
+	CArenaBlock *block = (CArenaBlock *)new char[ARENA_HEADER + size];
+
+	block->mSize = ARENA_HEADER + size;
+
+	if (aside) {
+		block->mNext = mBlocks->mNext;
+		mBlocks->mNext = block;
+	} else {
+		block->mNext = mBlocks;
+		mBlocks = block;
+	}
+
+	return (char *)block + ARENA_HEADER;
+}
+
+#undef ARENA_HEADER
+
+#endif /* __ARENA_HPP__ */
@@ -20,10 +20,10 @@
 #include <SharedPtr/SharedPtr.hpp>
 #include "PoolBase.hpp"
 
-template <class T>
+template <class T, class Backend = CPoolPageBackend>
 class CClassPool
 {
-	DEFINE_POOL_BASE(Pool, sizeof(T), T);
+	DEFINE_POOL_BASE_BACKEND(Pool, sizeof(T), T, Backend);
 public:
 	template <class... Tn>
 	static CSharedPtr<T> Alloc(Tn... params)
@@ -33,10 +33,54 @@ public:
 		T *obj = new (ptr) T(params...);
 
 		return CSharedPtr<T>(obj, [](T *buf) {
-			~buf();
+			buf->~T();
 			Pool::Release((char *)buf);
 		});
 	}
+
+	/* Construct n objects with the same params.
+	 * The blocks are taken from the pool in batches. */
+	template <class... Tn>
+	static void AllocBatch(CSharedPtr<T> *out, uint32_t n, Tn... params)
+	{
+		char *ptrs[POOL_BATCH_SIZE];
+
+		for (uint32_t i = 0; i < n; i += POOL_BATCH_SIZE) {
+			uint32_t cnt = (n - i < POOL_BATCH_SIZE) ? n - i : POOL_BATCH_SIZE;
+
+			Pool::AllocBatch(ptrs, cnt);
+
+			for (uint32_t j = 0; j < cnt; ++j) {
+				T *obj = new (ptrs[j]) T(params...);
+
+				out[i + j] = CSharedPtr<T>(obj, [](T *buf) {
+					buf->~T();
+					Pool::Release((char *)buf);
+				});
+			}
+		}
+	}
+
+	/* Make sure that n objects can be allocated without carving chunks */
+	inline static void Reserve(uint32_t n)
+	{
+		Pool::Reserve(n);
+	}
+
+	inline static void Flush(void)
+	{
+		Pool::Flush();
+	}
+
+	inline static void Trim(void)
+	{
+		Pool::Trim();
+	}
+
+	inline static void SetHighWater(uint32_t blocks)
+	{
+		Pool::SetHighWater(blocks);
+	}
 };
 
 #endif /* __CLASS_POOL_HPP__ */
@@ -22,15 +22,46 @@
 
 typedef CSharedPtr<char> CMemPtr;
 
-template <int size>
+template <int size, class Backend = CPoolPageBackend>
 class CMemPool
 {
-	DEFINE_POOL_BASE(Pool, size, CMemPool<size>);
+	DEFINE_POOL_BASE_BACKEND(Pool, size, CMemPool, Backend);
 public:
 	inline static CMemPtr Alloc(void)
 	{
 		return CMemPtr(Pool::Alloc(), Pool::Release);
 	}
+
+	/* Raw blocks, they are given back by ReleaseBatch() */
+	inline static void AllocBatch(char **out, uint32_t n)
+	{
+		Pool::AllocBatch(out, n);
+	}
+
+	inline static void ReleaseBatch(char **in, uint32_t n)
+	{
+		Pool::ReleaseBatch(in, n);
+	}
+
+	inline static void Reserve(uint32_t n)
+	{
+		Pool::Reserve(n);
+	}
+
+	inline static void Flush(void)
+	{
+		Pool::Flush();
+	}
+
+	inline static void Trim(void)
+	{
+		Pool::Trim();
+	}
+
+	inline static void SetHighWater(uint32_t blocks)
+	{
+		Pool::SetHighWater(blocks);
+	}
 };
 
 #endif /* __MEM_POOL_HPP__ */
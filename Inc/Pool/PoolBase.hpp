@@ -18,20 +18,67 @@
 #define POOL_BASE_HPP__
 
 #include <stdio.h>
+#include <new>
+#include <VirtualMemory.hpp>
 #include <DataStruct/SList.hpp>
 #include <Debug/TypeDebug.hpp>
 #include <Common/Color.hpp>
 
+/* Pool instrumentation level, normally given by the build
+ * (DEBUG_POOL in Make/Linux/Makefile):
+ *   0: Nothing, Alloc/Release are not instrumented at all.
+ *   1: Per-thread Alloc/Free/RealAlloc counters, merged when read.
+ *   2: Counters plus the per-pool trace ring. */
+#ifndef DEBUG_POOL_LEVEL
+#define DEBUG_POOL_LEVEL 0
+#endif
+
+#if DEBUG_POOL_LEVEL >= 1
+#define DEBUG_POOL_COUNTER
+#endif
+
+#if DEBUG_POOL_LEVEL >= 2
 #define DEBUG_POOL
+#endif
+
 //#define DEBUG_POOL_ALLOC
 
-#ifndef DEBUG_POOL
+#ifndef DEBUG_POOL_COUNTER
 #undef DEBUG_POOL_ALLOC
 #endif
 
 #define POOL_ALLOC_GRAN 16
 
-#ifdef DEBUG_POOL
+/* Number of blocks exchanged between the thread cache
+ * and the global free list at once. */
+#define POOL_BATCH_SIZE POOL_ALLOC_GRAN
+
+/* Blocks are carved from chunks of at least POOL_CHUNK_MIN bytes.
+ * A chunk is aligned to its (power of 2) size so the chunk of
+ * a block is found by masking its address. */
+#define POOL_CHUNK_MIN (4 * OS_PAGE_SIZE)
+#define POOL_CACHE_LINE 64
+#define POOL_CHUNK_HEADER POOL_CACHE_LINE
+
+/* How long Trim() waits for the running Pop() calls before
+ * it gives up decommitting, see VIRTUAL_DECOMMIT_FAULTS. */
+#define POOL_TRIM_SPIN 1000
+
+#ifdef DEBUG_POOL_COUNTER
+/* Counters of one thread.
+ * Only the owner thread writes them, so no atomic is needed.
+ * The records are never freed. When the thread exits, its record
+ * is handed over to the next new thread so the merged counts
+ * stay correct. */
+struct CPoolCounter
+{
+	uint32_t mRealAlloc;
+	uint32_t mAlloc;
+	uint32_t mFree;
+	uint32_t mInUse;
+	CPoolCounter *mNext;
+};
+
 struct CPoolList
 {
 	void (*Reset)(void);
@@ -39,6 +86,7 @@ struct CPoolList
 	void (*ShowTrace)(void);
 	int size;
 	CPoolList *mNext;
+	CPoolCounter *mCounters;
 };
 
 template <class T = CPoolList>
@@ -47,8 +95,9 @@ class CPoolStastics
 public:
 	static uint32_t RegisterPool(T *list)
 	{
-		list->mNext = sPoolList;
-		sPoolList = list;
+		do {
+			list->mNext = sPoolList;
+		} while (!ATOMIC_COMPARE_AND_SWAP(&sPoolList, list->mNext, list));
 
 		return 0;
 	}
@@ -117,28 +166,1015 @@ public:
 
 	static void ResetPool(void)
 	{
-		printf("Please enable DEBUG_POOL to debug Memory pool\n");
+		printf("Please build with DEBUG_POOL=1 to debug Memory pool\n");
 	}
 
 	static void ShowPoolUsage(void)
 	{
-		printf("Please enable DEBUG_POOL to debug Memory pool\n");
+		printf("Please build with DEBUG_POOL=1 to debug Memory pool\n");
 	}
 
 	static void ShowPoolTrace(int)
 	{
-		printf("Please enable DEBUG_POOL to debug Memory pool\n");
+		printf("Please build with DEBUG_POOL=1 to debug Memory pool\n");
+	}
+};
+
+#endif
+
+#ifdef DEBUG_POOL_COUNTER
+/* Thread-local handle of a CPoolCounter record of a pool.
+ * The pool is registered to CPoolStastics when its first
+ * record is created. */
+class CPoolCounterRef
+{
+public:
+	inline CPoolCounterRef(CPoolList *pool) :
+		mCounter(Acquire(pool))
+	{
+		/* Does nothing */
+	}
+
+	inline ~CPoolCounterRef(void)
+	{
+		ATOMIC_COMPARE_AND_SWAP(&mCounter->mInUse, 1, 0);
+	}
+
+	inline CPoolCounter *operator->(void) const
+	{
+		return mCounter;
+	}
+
+private:
+	static CPoolCounter *Acquire(CPoolList *pool)
+	{
+		CPoolCounter *counter = pool->mCounters;
+
+		for (; nullptr != counter; counter = counter->mNext) {
+			if (0 == counter->mInUse &&
+				ATOMIC_COMPARE_AND_SWAP(&counter->mInUse, 0, 1)) {
+				return counter;
+			}
+		}
+
+		counter = new CPoolCounter();
+		counter->mInUse = 1;
+
+		do {
+			counter->mNext = pool->mCounters;
+		} while (!ATOMIC_COMPARE_AND_SWAP(&pool->mCounters, counter->mNext, counter));
+
+		if (nullptr == counter->mNext) {
+			CPoolStastics<>::RegisterPool(pool);
+		}
+
+		return counter;
+	}
+
+private:
+	CPoolCounter *mCounter;
+};
+#endif
+
+/* A free block.
+ * While it is cached by a thread, the blocks are linked by mNext.
+ * While it heads a batch in the global list, mNext is used by SList,
+ * mBatch points to the rest of the batch and mCount is the batch size. */
+struct CPoolBlock
+{
+	CPoolBlock *mNext;
+	CPoolBlock *mBatch;
+	uint32_t mCount;
+};
+
+/* Owner of the chunks carved by a thread.
+ * Blocks released by other threads are sent back to mRemote in
+ * batches and the owner drains it when its magazine is empty.
+ * The records are never freed. After its thread exits, a record
+ * is taken over by the next new thread.
+ * mAlloc and mFree are only written by the thread of the record,
+ * the pool telemetry reads them without locking. */
+struct CPoolOwner
+{
+	SListHead mRemote;
+	CPoolOwner *mNext;
+	uint32_t mInUse;
+	uint64_t mAlloc;
+	uint64_t mFree;
+};
+
+/* Header of a chunk, in the first Header() bytes of the backend. */
+struct CPoolChunk
+{
+	/* Link of the idle chunk list */
+	CPoolChunk *mNext;
+
+	/* Owner of the blocks */
+	CPoolOwner *mOwner;
+
+	/* Number of blocks carved from the chunk */
+	uint32_t mBlocks;
+
+	/* Number of its blocks in the global list, only used by Trim() */
+	uint32_t mFree;
+};
+
+/* Backend of a pool: how blocks are laid out in a chunk and
+ * where the chunks come from. Selected per pool as a template
+ * parameter of CPoolBase/CMemPool/CClassPool. */
+
+/* Default backend: normal pages, pointer aligned blocks packed
+ * back to back, chunks of at least POOL_CHUNK_MIN. */
+struct CPoolPageBackend
+{
+	static constexpr uint32_t BlockSize(uint32_t size)
+	{
+		return (size + sizeof(void *) - 1) & ~(uint32_t)(sizeof(void *) - 1);
+	}
+
+	static constexpr uint32_t Header(void)
+	{
+		return POOL_CHUNK_HEADER;
+	}
+
+	static constexpr uint32_t ChunkSize(uint32_t block)
+	{
+		uint32_t chunk = POOL_CHUNK_MIN;
+
+		while (chunk < Header() + block * POOL_ALLOC_GRAN) {
+			chunk <<= 1;
+		}
+
+		return chunk;
+	}
+
+	static void *Map(size_t size)
+	{
+		return VirtualMapAligned(size, size);
+	}
+
+	/* Trim() gives the pages of the idle chunks back to the OS */
+	static constexpr bool Decommit(void)
+	{
+		return true;
+	}
+};
+
+/* Backend for the blocks aligned to align (a power of 2):
+ * the size of a block is rounded up to align and the first
+ * block starts at an aligned offset in the chunk. */
+template <uint32_t align>
+struct CPoolAlignedBackend : public CPoolPageBackend
+{
+	static constexpr uint32_t BlockSize(uint32_t size)
+	{
+		return (size + align - 1) & ~(align - 1);
+	}
+
+	static constexpr uint32_t Header(void)
+	{
+		return align > POOL_CHUNK_HEADER ? align : POOL_CHUNK_HEADER;
+	}
+
+	static constexpr uint32_t ChunkSize(uint32_t block)
+	{
+		uint32_t chunk = POOL_CHUNK_MIN;
+
+		while (chunk < Header() + block * POOL_ALLOC_GRAN) {
+			chunk <<= 1;
+		}
+
+		return chunk;
+	}
+};
+
+/* Slab backend: chunks of at least OS_HUGE_PAGE_SIZE backed by
+ * huge pages when possible and cache line aligned blocks.
+ * For hot pools whose blocks are spread over many pages. */
+struct CPoolHugeBackend
+{
+	static constexpr uint32_t BlockSize(uint32_t size)
+	{
+		return (size + POOL_CACHE_LINE - 1) & ~(POOL_CACHE_LINE - 1);
+	}
+
+	static constexpr uint32_t Header(void)
+	{
+		return POOL_CHUNK_HEADER;
+	}
+
+	static constexpr uint32_t ChunkSize(uint32_t block)
+	{
+		uint32_t chunk = OS_HUGE_PAGE_SIZE;
+
+		while (chunk < Header() + block * POOL_ALLOC_GRAN) {
+			chunk <<= 1;
+		}
+
+		return chunk;
+	}
+
+	static void *Map(size_t size)
+	{
+		return VirtualMapHuge(size, size);
+	}
+
+	/* The header page of an idle chunk keeps the idle list, but
+	 * the rest is not a whole huge page: MADV_DONTNEED fails on it
+	 * with EINVAL for hugetlbfs pages and splits a transparent
+	 * huge page. So Trim() keeps the idle chunks committed and
+	 * they are reused as they are, the memory is not given back. */
+	static constexpr bool Decommit(void)
+	{
+		return false;
+	}
+};
+
+/* Telemetry of a pool. The counters are read without locking,
+ * so a snapshot is only consistent when the pool is idle.
+ * The rates are the difference of two snapshots. */
+struct CPoolUsage
+{
+	/* Size of a block and of a chunk in bytes */
+	uint32_t mBlockSize;
+	uint32_t mChunkSize;
+
+	/* Chunks mapped and chunks given back to the OS by Trim() */
+	uint32_t mChunks;
+	uint32_t mIdleChunks;
+
+	/* Bytes of the chunks in use */
+	uint64_t mReserved;
+
+	/* Number of Alloc() and Release() since the pool is created */
+	uint64_t mAlloc;
+	uint64_t mFree;
+
+	/* Blocks allocated and not released yet */
+	uint64_t mLive;
+
+	/* Free blocks in the global list, and the ones cached by
+	 * the threads or on their way back to their owner */
+	uint64_t mCached;
+	uint64_t mThreadCached;
+
+	/* CAS retried on the global list and the remote lists */
+	uint32_t mRetries;
+
+	/* Most threads having used the pool at the same time */
+	uint32_t mThreads;
+};
+
+class CPoolDepot;
+
+/* Always-on registry of the pools, for the telemetry.
+ * A pool is registered when its first chunk is mapped. */
+template <class T = CPoolDepot>
+class CPoolTelemetry
+{
+public:
+	static void Register(T *depot)
+	{
+		do {
+			depot->mNextDepot = sDepots;
+		} while (!ATOMIC_COMPARE_AND_SWAP(&sDepots, depot->mNextDepot, depot));
+	}
+
+	/* fn(const CPoolUsage &) is called for each pool */
+	template <class Fn>
+	static void ForEach(const Fn &fn)
+	{
+		for (T *depot = sDepots; nullptr != depot; depot = depot->mNextDepot) {
+			CPoolUsage usage;
+
+			depot->GetUsage(usage);
+			fn(usage);
+		}
 	}
+
+private:
+	static T *sDepots;
 };
 
+template <class T>
+T *CPoolTelemetry<T>::sDepots = nullptr;
+
+/* Memory of a pool shared by all the threads:
+ * the global list of free batches and the chunks. */
+class CPoolDepot
+{
+public:
+	constexpr CPoolDepot(uint32_t block, uint32_t chunk, uint32_t header,
+						 void *(*map)(size_t), bool decommit) :
+		mHead(),
+		mIdle(),
+		mOwners(nullptr),
+		mMap(map),
+		mBlockSize(block),
+		mChunkSize(chunk),
+		mHeader(header),
+		mCached(0),
+		mHighWater(0),
+		mTrimmedAt(0),
+		mTrimming(0),
+		mDecommit(decommit),
+#ifdef VIRTUAL_DECOMMIT_FAULTS
+		mPopping(0),
+#endif
+		mChunks(0),
+		mIdleChunks(0),
+		mRetries(0),
+		mNextDepot(nullptr)
+	{
+		/* Does nothing */
+	}
+
+	inline void *Head(void) const
+	{
+		return SList::Peek(&mHead);
+	}
+
+	/* Push a chain of cnt blocks as a batch. */
+	inline void Push(CPoolBlock *chain, uint32_t cnt)
+	{
+		PushBatch(chain, cnt);
+	}
+
+	/* Push the batches from first to last (linked by mNext)
+	 * with one CAS, cnt is the total number of blocks. */
+	inline void PushChain(CPoolBlock *first, CPoolBlock *last, uint32_t cnt)
+	{
+		ATOMIC_ADD_AND_FETCH(&mCached, cnt);
+		SList::PushChain(&mHead, (SList *)first, (SList *)last, &mRetries);
+	}
+
+	/* Pop a batch, the rest of the batch is in mBatch. */
+	inline CPoolBlock *Pop(void)
+	{
+#ifdef VIRTUAL_DECOMMIT_FAULTS
+		ATOMIC_ADD_AND_FETCH(&mPopping, 1);
+		CPoolBlock *batch = (CPoolBlock *)SList::Pop(&mHead, &mRetries);
+		ATOMIC_SUB_AND_FETCH(&mPopping, 1);
+#else
+		CPoolBlock *batch = (CPoolBlock *)SList::Pop(&mHead, &mRetries);
 #endif
 
+		if (nullptr != batch) {
+			uint32_t cached = ATOMIC_SUB_AND_FETCH(&mCached, batch->mCount);
+
+			/* Only a hint for CheckHighWater(), races are harmless */
+			if (cached < mTrimmedAt) {
+				mTrimmedAt = cached;
+			}
+		}
+
+		return batch;
+	}
+
+	/* Get an idle chunk or map a new one. */
+	inline CPoolChunk *NewChunk(CPoolOwner *owner)
+	{
+		CPoolChunk *chunk = (CPoolChunk *)SList::Pop(&mIdle);
+
+		if (nullptr != chunk) {
+			if (!VirtualCommit((char *)chunk + OS_PAGE_SIZE, mChunkSize - OS_PAGE_SIZE)) {
+				SList::Push(&mIdle, (SList *)chunk);
+				throw std::bad_alloc();
+			}
+
+			ATOMIC_SUB_AND_FETCH(&mIdleChunks, 1);
+		} else {
+			chunk = (CPoolChunk *)mMap(mChunkSize);
+			if (nullptr == chunk) {
+				throw std::bad_alloc();
+			}
+
+			if (1 == ATOMIC_ADD_AND_FETCH(&mChunks, 1)) {
+				CPoolTelemetry<>::Register(this);
+			}
+
+			chunk->mBlocks = (mChunkSize - mHeader) / mBlockSize;
+		}
+
+		chunk->mOwner = owner;
+
+		return chunk;
+	}
+
+	/* Carve a new chunk for owner.
+	 * The first block is returned, the first batch is returned by
+	 * first and cnt, the other batches are pushed with one CAS. */
+	inline char *Carve(CPoolOwner *owner, CPoolBlock *&first, uint32_t &cnt)
+	{
+		CPoolChunk *chunk = NewChunk(owner);
+		char *ret = (char *)chunk + mHeader;
+		char *ptr = ret;
+		CPoolBlock *chain = nullptr;
+		CPoolBlock *batches = nullptr;
+		CPoolBlock *last = nullptr;
+		uint32_t total = 0;
+		uint32_t n = 0;
+
+		first = nullptr;
+		cnt = 0;
+
+		for (uint32_t i = 1; i < chunk->mBlocks; ++i) {
+			CPoolBlock *block = (CPoolBlock *)(ptr += mBlockSize);
+
+			block->mNext = chain;
+			chain = block;
+
+			if (POOL_BATCH_SIZE != ++n && chunk->mBlocks - 1 != i) {
+				continue;
+			}
+
+			if (nullptr == first) {
+				first = chain;
+				cnt = n;
+			} else {
+				chain->mBatch = chain->mNext;
+				chain->mCount = n;
+				chain->mNext = batches;
+				batches = chain;
+				last = (nullptr == last) ? chain : last;
+				total += n;
+			}
+
+			chain = nullptr;
+			n = 0;
+		}
+
+		if (nullptr != batches) {
+			ATOMIC_ADD_AND_FETCH(&mCached, total);
+			SList::PushChain(&mHead, (SList *)batches, (SList *)last, &mRetries);
+		}
+
+		return ret;
+	}
+
+	/* Carve chunks until there are n free blocks in the global list */
+	inline void Reserve(CPoolOwner *owner, uint32_t n)
+	{
+		while (mCached < n) {
+			CPoolBlock *first;
+			uint32_t cnt;
+			CPoolBlock *block = (CPoolBlock *)Carve(owner, first, cnt);
+
+			block->mNext = nullptr;
+			PushBatch(block, 1);
+
+			if (nullptr != first) {
+				PushBatch(first, cnt);
+			}
+		}
+	}
+
+	inline CPoolChunk *GetChunk(CPoolBlock *block) const
+	{
+		return (CPoolChunk *)((uintptr_t)block & ~(uintptr_t)(mChunkSize - 1));
+	}
+
+	/* Take a free owner record or create a new one. */
+	inline CPoolOwner *AcquireOwner(void)
+	{
+		CPoolOwner *owner = mOwners;
+
+		for (; nullptr != owner; owner = owner->mNext) {
+			if (0 == owner->mInUse &&
+				ATOMIC_COMPARE_AND_SWAP(&owner->mInUse, 0, 1)) {
+				return owner;
+			}
+		}
+
+		owner = new CPoolOwner();
+		owner->mInUse = 1;
+		owner->mAlloc = 0;
+		owner->mFree = 0;
+
+		do {
+			owner->mNext = mOwners;
+		} while (!ATOMIC_COMPARE_AND_SWAP(&mOwners, owner->mNext, owner));
+
+		return owner;
+	}
+
+	/* Blocks sent to the owner after this are collected
+	 * by Trim() or by the next thread taking the record. */
+	inline void ReleaseOwner(CPoolOwner *owner)
+	{
+		DrainRemote(owner);
+		ATOMIC_COMPARE_AND_SWAP(&owner->mInUse, 1, 0);
+	}
+
+	/* Send a chain of cnt blocks to their owner as a batch. */
+	inline void PushRemote(CPoolOwner *owner, CPoolBlock *chain, uint32_t cnt)
+	{
+		chain->mBatch = chain->mNext;
+		chain->mCount = cnt;
+		SList::Push(&owner->mRemote, (SList *)chain, &mRetries);
+	}
+
+	/* Move the batches sent to owner to the global list. */
+	inline void DrainRemote(CPoolOwner *owner)
+	{
+		CPoolBlock *batch = (CPoolBlock *)SList::PopAll(&owner->mRemote);
+
+		PushBatches(batch);
+	}
+
+	/* Push a list of batches linked by mNext to the global list. */
+	inline void PushBatches(CPoolBlock *batch)
+	{
+		while (nullptr != batch) {
+			CPoolBlock *next = batch->mNext;
+
+			batch->mNext = batch->mBatch;
+			PushBatch(batch, batch->mCount);
+			batch = next;
+		}
+	}
+
+	/* Trim() is called by CheckHighWater() when there are more
+	 * than blocks free blocks in the global list. 0 disables it.
+	 * It is not called again until the free blocks have doubled
+	 * (or grown by a chunk) from the fewest since the last Trim(). */
+	inline void SetHighWater(uint32_t blocks)
+	{
+		mHighWater = blocks;
+	}
+
+	/* Give the chunks whose blocks are all free back to the OS.
+	 * Blocks cached by the threads are not seen here, so a chunk
+	 * is trimmed only when all its blocks are in the global list.
+	 * The chunk is decommitted instead of unmapped: a thread in
+	 * SList::Pop may still read a block of it. It reads zeros and
+	 * its CAS fails since the head has been changed. Where such a
+	 * read faults (VIRTUAL_DECOMMIT_FAULTS), the chunks are only
+	 * decommitted once the Pop() calls that may have seen them
+	 * are over, otherwise they are kept committed. The chunks of
+	 * a backend without Decommit() are only moved to the idle list. */
+	inline void Trim(void)
+	{
+		if (!ATOMIC_COMPARE_AND_SWAP(&mTrimming, 0, 1)) {
+			return;
+		}
+
+		/* Collect the blocks sent to the exited threads */
+		for (CPoolOwner *owner = mOwners; nullptr != owner; owner = owner->mNext) {
+			if (0 == owner->mInUse) {
+				DrainRemote(owner);
+			}
+		}
+
+		CPoolBlock *head = (CPoolBlock *)SList::PopAll(&mHead);
+		CPoolBlock *all = nullptr;
+		CPoolBlock *batch = nullptr;
+		CPoolChunk *idle = nullptr;
+		uint32_t cnt = 0;
+
+		/* Flatten the batches and count the free blocks of each chunk */
+		while (nullptr != head) {
+			CPoolBlock *block = head;
+
+			cnt += head->mCount;
+			head = head->mNext;
+			block->mNext = block->mBatch;
+
+			while (nullptr != block) {
+				CPoolBlock *next = block->mNext;
+
+				++GetChunk(block)->mFree;
+				block->mNext = all;
+				all = block;
+				block = next;
+			}
+		}
+
+		ATOMIC_SUB_AND_FETCH(&mCached, cnt);
+
+		/* Push back the blocks of the chunks in use */
+		for (cnt = 0; nullptr != all;) {
+			CPoolBlock *block = all;
+			CPoolChunk *chunk = GetChunk(block);
+
+			all = block->mNext;
+
+			if (chunk->mBlocks == chunk->mFree) {
+				chunk->mFree = UINT32_MAX;
+				chunk->mNext = idle;
+				idle = chunk;
+				continue;
+			} else if (UINT32_MAX == chunk->mFree) {
+				continue;
+			}
+
+			chunk->mFree = 0;
+			block->mNext = batch;
+			batch = block;
+
+			if (POOL_BATCH_SIZE == ++cnt) {
+				PushBatch(batch, cnt);
+				batch = nullptr;
+				cnt = 0;
+			}
+		}
+
+		if (0 != cnt) {
+			PushBatch(batch, cnt);
+		}
+
+		mTrimmedAt = mCached;
+
+		bool decommit = mDecommit;
+
+#ifdef VIRTUAL_DECOMMIT_FAULTS
+		/* A Pop() started after the wait only sees the list
+		 * pushed back above, which has no block of idle. */
+		for (uint32_t i = 0; 0 != mPopping; ++i) {
+			if (POOL_TRIM_SPIN == i) {
+				decommit = false;
+				break;
+			}
+		}
+#endif
+
+		/* The header page is kept for the idle list */
+		while (nullptr != idle) {
+			CPoolChunk *chunk = idle;
+
+			idle = chunk->mNext;
+			chunk->mFree = 0;
+
+			/* A pool the OS refuses to decommit stops trying,
+			 * its idle chunks stay committed. */
+			if (decommit &&
+				!VirtualDecommit((char *)chunk + OS_PAGE_SIZE, mChunkSize - OS_PAGE_SIZE)) {
+				mDecommit = false;
+				decommit = false;
+			}
+
+			SList::Push(&mIdle, (SList *)chunk);
+			ATOMIC_ADD_AND_FETCH(&mIdleChunks, 1);
+		}
+
+		ATOMIC_COMPARE_AND_SWAP(&mTrimming, 1, 0);
+	}
+
+	inline void GetUsage(CPoolUsage &usage) const
+	{
+		uint32_t chunks = mChunks;
+		uint32_t idle = mIdleChunks;
+		uint64_t blocks = (uint64_t)(chunks - idle) *
+			((mChunkSize - mHeader) / mBlockSize);
+
+		usage.mBlockSize = mBlockSize;
+		usage.mChunkSize = mChunkSize;
+		usage.mChunks = chunks;
+		usage.mIdleChunks = idle;
+		usage.mReserved = (uint64_t)(chunks - idle) * mChunkSize;
+		usage.mAlloc = 0;
+		usage.mFree = 0;
+		usage.mThreads = 0;
+
+		for (CPoolOwner *owner = mOwners; nullptr != owner; owner = owner->mNext) {
+			usage.mAlloc += owner->mAlloc;
+			usage.mFree += owner->mFree;
+			++usage.mThreads;
+		}
+
+		usage.mLive = usage.mAlloc - usage.mFree;
+		usage.mCached = mCached;
+		usage.mThreadCached = blocks - usage.mLive - usage.mCached;
+		usage.mRetries = mRetries;
+	}
+
+	/* Called when a thread flushes its magazine, not by Push():
+	 * a Trim() walks all the free blocks, which are cold, and
+	 * would cost hundreds of ns per block on the Release path.
+	 * The blocks left in partly used chunks are not trimmed, so
+	 * without the mTrimmedAt limit every check would walk them
+	 * again while the list is taken away from Pop(). Waiting for
+	 * the free blocks to double keeps the walks O(1) per block. */
+	inline void CheckHighWater(void)
+	{
+		uint32_t cached = mCached;
+		uint32_t chunk = (mChunkSize - mHeader) / mBlockSize;
+
+		if (0 != mHighWater && cached > mHighWater &&
+			cached > mTrimmedAt + (mTrimmedAt > chunk ? mTrimmedAt : chunk)) {
+			Trim();
+		}
+	}
+
+private:
+	inline void PushBatch(CPoolBlock *chain, uint32_t cnt)
+	{
+		chain->mBatch = chain->mNext;
+		chain->mCount = cnt;
+		ATOMIC_ADD_AND_FETCH(&mCached, cnt);
+		SList::Push(&mHead, (SList *)chain, &mRetries);
+	}
+
+private:
+	SListHead mHead;
+	SListHead mIdle;
+	CPoolOwner *mOwners;
+	void *(*mMap)(size_t);
+	uint32_t mBlockSize;
+	uint32_t mChunkSize;
+	uint32_t mHeader;
+	uint32_t mCached;
+	uint32_t mHighWater;
+	uint32_t mTrimmedAt;
+	uint32_t mTrimming;
+	bool mDecommit;
+#ifdef VIRTUAL_DECOMMIT_FAULTS
+	uint32_t mPopping;
+#endif
+
+	/* Telemetry */
+	uint32_t mChunks;
+	uint32_t mIdleChunks;
+	uint32_t mRetries;
+	CPoolDepot *mNextDepot;
+
+	friend class CPoolTelemetry<>;
+};
+
+/* Per-thread cache (magazine) in front of the global free list.
+ * It keeps two stacks of at most POOL_BATCH_SIZE blocks:
+ * mLoaded serves Alloc/Release and mPrev is swapped in when
+ * mLoaded is empty (Alloc) or full (Release).
+ * Only when both of them are empty/full, a whole batch is
+ * exchanged with the global list by a single CAS.
+ *
+ * Blocks of chunks owned by other threads are gathered in
+ * mPending and sent back to their owner by batch. When the
+ * magazine is empty, the batches sent back to this thread
+ * (mStash) are used before the global list. */
+class CPoolMagazine
+{
+public:
+	inline CPoolMagazine(CPoolDepot *depot) :
+		mDepot(depot),
+		mOwner(depot->AcquireOwner()),
+		mLoaded(nullptr),
+		mPrev(nullptr),
+		mLoadedCnt(0),
+		mPrevCnt(0),
+		mPendingOwner(nullptr),
+		mPending(nullptr),
+		mPendingCnt(0),
+		mStash(nullptr)
+	{
+		/* Does nothing */
+	}
+
+	inline ~CPoolMagazine(void)
+	{
+		Flush();
+		mDepot->ReleaseOwner(mOwner);
+		mDepot->CheckHighWater();
+	}
+
+	inline CPoolOwner *GetOwner(void) const
+	{
+		return mOwner;
+	}
+
+	/* Returns nullptr if both the magazine and the global list are empty. */
+	inline char *Alloc(void)
+	{
+		if (0 == mLoadedCnt) {
+			if (0 == mPrevCnt && !Reload()) {
+				return nullptr;
+			}
+
+			Swap();
+		}
+
+		CPoolBlock *block = mLoaded;
+		mLoaded = block->mNext;
+		--mLoadedCnt;
+
+		return (char *)block;
+	}
+
+	inline void Release(char *buf)
+	{
+		CPoolBlock *block = (CPoolBlock *)buf;
+		CPoolOwner *owner = mDepot->GetChunk(block)->mOwner;
+
+		if (owner != mOwner) {
+			ReleaseRemote(block, owner);
+			return;
+		}
+
+		if (POOL_BATCH_SIZE == mLoadedCnt) {
+			if (0 != mPrevCnt) {
+				Unload();
+			}
+
+			Swap();
+		}
+
+		block->mNext = mLoaded;
+		mLoaded = block;
+		++mLoadedCnt;
+	}
+
+	/* Alloc up to n blocks to out from the magazine and the global list.
+	 * Returns the number of blocks allocated. */
+	inline uint32_t AllocBatch(char **out, uint32_t n)
+	{
+		uint32_t i = 0;
+
+		while (i < n) {
+			if (0 == mLoadedCnt) {
+				if (0 == mPrevCnt && !Reload()) {
+					break;
+				}
+
+				Swap();
+			}
+
+			for (; i < n && 0 != mLoadedCnt; --mLoadedCnt) {
+				out[i++] = (char *)mLoaded;
+				mLoaded = mLoaded->mNext;
+			}
+		}
+
+		return i;
+	}
+
+	/* The full batches are pushed to the global list with one CAS,
+	 * the rest goes to the magazine. */
+	inline void ReleaseBatch(char **in, uint32_t n)
+	{
+		CPoolBlock *chain = nullptr;
+		CPoolBlock *batches = nullptr;
+		CPoolBlock *last = nullptr;
+		uint32_t total = 0;
+		uint32_t cnt = 0;
+
+		for (uint32_t i = 0; i < n; ++i) {
+			CPoolBlock *block = (CPoolBlock *)in[i];
+			CPoolOwner *owner = mDepot->GetChunk(block)->mOwner;
+
+			if (owner != mOwner) {
+				ReleaseRemote(block, owner);
+				continue;
+			}
+
+			block->mNext = chain;
+			chain = block;
+
+			if (POOL_BATCH_SIZE == ++cnt) {
+				chain->mBatch = chain->mNext;
+				chain->mCount = cnt;
+				chain->mNext = batches;
+				batches = chain;
+				last = (nullptr == last) ? chain : last;
+				total += cnt;
+				chain = nullptr;
+				cnt = 0;
+			}
+		}
+
+		if (nullptr != batches) {
+			mDepot->PushChain(batches, last, total);
+		}
+
+		while (nullptr != chain) {
+			CPoolBlock *next = chain->mNext;
+
+			Release((char *)chain);
+			chain = next;
+		}
+	}
+
+	/* Load a chain of new blocks. Called only when the magazine is empty. */
+	inline void Fill(CPoolBlock *chain, uint32_t count)
+	{
+		mLoaded = chain;
+		mLoadedCnt = count;
+	}
+
+	/* Return all the cached blocks to the global list
+	 * and send the pending blocks to their owners. */
+	inline void Flush(void)
+	{
+		if (0 != mPrevCnt) {
+			Unload();
+		}
+
+		Swap();
+
+		if (0 != mPrevCnt) {
+			Unload();
+		}
+
+		SendPending();
+
+		mDepot->PushBatches(mStash);
+		mStash = nullptr;
+		mDepot->DrainRemote(mOwner);
+	}
+
+private:
+	inline void Swap(void)
+	{
+		CPoolBlock *block = mLoaded;
+		uint32_t cnt = mLoadedCnt;
+
+		mLoaded = mPrev;
+		mLoadedCnt = mPrevCnt;
+		mPrev = block;
+		mPrevCnt = cnt;
+	}
+
+	inline void ReleaseRemote(CPoolBlock *block, CPoolOwner *owner)
+	{
+		if (owner != mPendingOwner) {
+			SendPending();
+			mPendingOwner = owner;
+		}
+
+		block->mNext = mPending;
+		mPending = block;
+
+		if (POOL_BATCH_SIZE == ++mPendingCnt) {
+			SendPending();
+		}
+	}
+
+	inline void SendPending(void)
+	{
+		if (0 != mPendingCnt) {
+			mDepot->PushRemote(mPendingOwner, mPending, mPendingCnt);
+			mPending = nullptr;
+			mPendingCnt = 0;
+		}
+	}
+
+	/* Pop a batch to mPrev. The batches sent back by the other
+	 * threads are taken all at once and used first. */
+	inline bool Reload(void)
+	{
+		if (nullptr == mStash) {
+			mStash = (CPoolBlock *)SList::PopAll(&mOwner->mRemote);
+		}
+
+		CPoolBlock *batch = mStash;
+
+		if (nullptr != batch) {
+			mStash = batch->mNext;
+		} else {
+			batch = mDepot->Pop();
+			if (nullptr == batch) {
+				return false;
+			}
+		}
+
+		batch->mNext = batch->mBatch;
+		mPrev = batch;
+		mPrevCnt = batch->mCount;
+
+		return true;
+	}
+
+	/* Push mPrev to the global list as a batch. */
+	inline void Unload(void)
+	{
+		mDepot->Push(mPrev, mPrevCnt);
+
+		mPrev = nullptr;
+		mPrevCnt = 0;
+	}
+
+private:
+	CPoolDepot *mDepot;
+	CPoolOwner *mOwner;
+	CPoolBlock *mLoaded;
+	CPoolBlock *mPrev;
+	uint32_t mLoadedCnt;
+	uint32_t mPrevCnt;
+
+	/* Blocks to send back to mPendingOwner */
+	CPoolOwner *mPendingOwner;
+	CPoolBlock *mPending;
+	uint32_t mPendingCnt;
+
+	/* Batches sent back by the other threads */
+	CPoolBlock *mStash;
+};
+
 #ifdef DEBUG_POOL_ALLOC
-#define POOL_BASE_TEMPLATE template <int size, class T>
-#define POOL_BASE_TEMPLATE_IMPL size, T
+#define POOL_BASE_TEMPLATE template <int size, class T, class Backend>
+#define POOL_BASE_TEMPLATE_IMPL size, T, Backend
 #else
-#define POOL_BASE_TEMPLATE template <int size>
-#define POOL_BASE_TEMPLATE_IMPL size
+#define POOL_BASE_TEMPLATE template <int size, class Backend>
+#define POOL_BASE_TEMPLATE_IMPL size, Backend
 #endif
 
 POOL_BASE_TEMPLATE
@@ -152,12 +1188,16 @@ public:
 		PoolTrace *trace = &sPoolTrace[idx & (TRACE_CNT - 1)];
 		trace->ops = ALLOC_IN;
 		trace->ptr = 0;
-		trace->head = sPoolHead;
+		trace->head = sDepot.Head();
+#endif
 
-		ATOMIC_ADD_AND_FETCH(&sAlloc, 1);
+#ifdef DEBUG_POOL_COUNTER
+		++sCounter->mAlloc;
 #endif
 
-		char *ptr = (char *)SList::Pop(&sPoolHead);
+		++sMagazine.GetOwner()->mAlloc;
+
+		char *ptr = sMagazine.Alloc();
 		char *ret = (NULL == ptr) ? RealAlloc() : ptr;
 
 #ifdef DEBUG_POOL
@@ -165,7 +1205,7 @@ public:
 		trace = &sPoolTrace[idx & (TRACE_CNT - 1)];
 		trace->ops = ALLOC_OUT;
 		trace->ptr = ret;
-		trace->head = sPoolHead;
+		trace->head = sDepot.Head();
 #endif
 		return ret;
 	}
@@ -177,93 +1217,154 @@ public:
 		PoolTrace *trace = &sPoolTrace[idx & (TRACE_CNT - 1)];
 		trace->ops = FREE_IN;
 		trace->ptr = buf;
-		trace->head = sPoolHead;
+		trace->head = sDepot.Head();
+#endif
 
-		ATOMIC_ADD_AND_FETCH(&sFree, 1);
+#ifdef DEBUG_POOL_COUNTER
+		++sCounter->mFree;
 #endif
 
-		SList::Push(&sPoolHead, (SList *)buf);
+		++sMagazine.GetOwner()->mFree;
+		sMagazine.Release(buf);
 
 #ifdef DEBUG_POOL
 		idx = ATOMIC_FETCH_AND_ADD(&sPoolTraceIdx, 1);
 		trace = &sPoolTrace[idx & (TRACE_CNT - 1)];
 		trace->ops = FREE_OUT;
 		trace->ptr = 0;
-		trace->head = sPoolHead;
+		trace->head = sDepot.Head();
 #endif
 	}
-	
-private:
-	inline static char *RealAlloc(void)
+
+	/* Give the fully free chunks back to the OS.
+	 * The blocks cached by the calling thread are flushed first. */
+	inline static void Trim(void)
 	{
-		char *ptr = new char[size * POOL_ALLOC_GRAN];
+		sMagazine.Flush();
+		sDepot.Trim();
+	}
 
-		for (int i = 0; i < POOL_ALLOC_GRAN - 1; ++i) {
-#ifdef DEBUG_POOL
-			uint32_t idx = ATOMIC_FETCH_AND_ADD(&sPoolTraceIdx, 1);
-			PoolTrace *trace = &sPoolTrace[idx & (TRACE_CNT - 1)];
-			trace->ops = REAL_ALLOC;
-			trace->ptr = ptr;
-			trace->head = sPoolHead;
+	/* Return the blocks cached by the calling thread to the global
+	 * list. It is trimmed if it is above the high water. */
+	inline static void Flush(void)
+	{
+		sMagazine.Flush();
+		sDepot.CheckHighWater();
+	}
+
+	/* Trim automatically when more than blocks blocks are free
+	 * in the global list. 0 (default) disables it. It is checked
+	 * by Flush() and when a thread exits, not by Release(). */
+	inline static void SetHighWater(uint32_t blocks)
+	{
+		sDepot.SetHighWater(blocks);
+	}
+
+	/* Alloc n blocks to out. The blocks are taken by whole
+	 * batches, one CAS for POOL_BATCH_SIZE blocks. */
+	inline static void AllocBatch(char **out, uint32_t n)
+	{
+#ifdef DEBUG_POOL_COUNTER
+		sCounter->mAlloc += n;
 #endif
-			SList::Push(&sPoolHead, (SList *)ptr);
-			ptr += size;
+
+		sMagazine.GetOwner()->mAlloc += n;
+
+		uint32_t i = sMagazine.AllocBatch(out, n);
+
+		while (i < n) {
+			out[i++] = RealAlloc();
+			i += sMagazine.AllocBatch(out + i, n - i);
 		}
+	}
+
+	/* Release n blocks. The full batches are pushed with one CAS. */
+	inline static void ReleaseBatch(char **in, uint32_t n)
+	{
+#ifdef DEBUG_POOL_COUNTER
+		sCounter->mFree += n;
+#endif
+
+		sMagazine.GetOwner()->mFree += n;
+		sMagazine.ReleaseBatch(in, n);
+	}
+
+	/* Make sure that n blocks can be allocated without carving chunks */
+	inline static void Reserve(uint32_t n)
+	{
+		sDepot.Reserve(sMagazine.GetOwner(), n);
+	}
+
+private:
+	/* The magazine is empty when this is called.
+	 * The first batch of a new chunk is loaded to the
+	 * magazine directly, the rest goes to the global list. */
+	inline static char *RealAlloc(void)
+	{
+		CPoolBlock *first;
+		uint32_t cnt;
+		char *ret = sDepot.Carve(sMagazine.GetOwner(), first, cnt);
+
+		sMagazine.Fill(first, cnt);
 
 #ifdef DEBUG_POOL
 		uint32_t idx = ATOMIC_FETCH_AND_ADD(&sPoolTraceIdx, 1);
 		PoolTrace *trace = &sPoolTrace[idx & (TRACE_CNT - 1)];
 		trace->ops = REAL_ALLOC;
-		trace->ptr = ptr;
-		trace->head = sPoolHead;
+		trace->ptr = ret;
+		trace->head = sDepot.Head();
+#endif
 
-		ATOMIC_ADD_AND_FETCH(&sRealAlloc, 1);
+#ifdef DEBUG_POOL_COUNTER
+		++sCounter->mRealAlloc;
 #endif
 
-		return ptr;
+		return ret;
 	}
 
-	static uint64_t sPoolHead;
-
-#ifdef DEBUG_POOL
-private:
-	enum PoolOps {
-		ALLOC_IN,
-		ALLOC_OUT,
-		FREE_IN,
-		FREE_OUT,
-		REAL_ALLOC,
-		POOL_OPS_MAX,
-	};
+	static constexpr uint32_t BLOCK_SIZE = Backend::BlockSize(size);
 
-	static const char *PoolOpsStr[POOL_OPS_MAX];
+	static CPoolDepot sDepot;
+	static thread_local CPoolMagazine sMagazine;
 
-	struct PoolTrace {
-		PoolOps ops;
-		char *ptr;
-		uint64_t head;
-	};
+#ifdef DEBUG_POOL_COUNTER
+private:
+	static CPoolList sList;
+	static thread_local CPoolCounterRef sCounter;
 
-	static const uint32_t TRACE_CNT = 0x100;
+	/* Counts at the last Reset() */
+	static CPoolCounter sBase;
 
-	static CPoolList sList;
+	/* Merge the counters of all the threads. */
+	inline static void Sum(CPoolCounter &sum)
+	{
+		CPoolCounter *counter = sList.mCounters;
 
-	static PoolTrace sPoolTrace[TRACE_CNT];
-	static uint32_t sPoolTraceIdx;
+		sum.mRealAlloc = 0;
+		sum.mAlloc = 0;
+		sum.mFree = 0;
 
-	static uint32_t sRealAlloc;
-	static uint32_t sAlloc;
-	static uint32_t sFree;
+		for (; nullptr != counter; counter = counter->mNext) {
+			sum.mRealAlloc += counter->mRealAlloc;
+			sum.mAlloc += counter->mAlloc;
+			sum.mFree += counter->mFree;
+		}
+	}
 
 	inline static void Reset(void)
 	{
-		sAlloc = 0;
-		sFree = 0;
+		Sum(sBase);
 	}
 
 	inline static void ShowUsage(void)
 	{
-		if (sAlloc == sFree) {
+		CPoolCounter sum;
+
+		Sum(sum);
+		sum.mAlloc -= sBase.mAlloc;
+		sum.mFree -= sBase.mFree;
+
+		if (sum.mAlloc == sum.mFree) {
 			printf(COLOR_GREEN);
 		} else {
 			printf(COLOR_RED);
@@ -274,13 +1375,36 @@ private:
 			   ", %s"
 #endif
 			   COLOR_NONE "\n",
-			   size, sRealAlloc, sAlloc, sFree
+			   size, sum.mRealAlloc, sum.mAlloc, sum.mFree
 #ifdef DEBUG_POOL_ALLOC
 			   ,TYPE_NAME(T)
 #endif
 			  );
 	}
 
+#ifdef DEBUG_POOL
+	enum PoolOps {
+		ALLOC_IN,
+		ALLOC_OUT,
+		FREE_IN,
+		FREE_OUT,
+		REAL_ALLOC,
+		POOL_OPS_MAX,
+	};
+
+	static const char *PoolOpsStr[POOL_OPS_MAX];
+
+	struct PoolTrace {
+		PoolOps ops;
+		char *ptr;
+		void *head;
+	};
+
+	static const uint32_t TRACE_CNT = 0x100;
+
+	static PoolTrace sPoolTrace[TRACE_CNT];
+	static uint32_t sPoolTraceIdx;
+
 	inline static void ShowTrace(void)
 	{
 		printf("Totally %d entries\n", sPoolTraceIdx);
@@ -293,12 +1417,31 @@ private:
 
 			printf("%s 0x%016lx  0x%016lx\n",
 				   PoolOpsStr[trace->ops],
-				   (uint64_t)trace->ptr, trace->head);
+				   (uint64_t)trace->ptr, (uint64_t)trace->head);
 		}
 	}
+#else
+	inline static void ShowTrace(void)
+	{
+		printf("Please build with DEBUG_POOL=2 to trace Memory pool\n");
+	}
+#endif
 #endif
 };
 
+#ifdef DEBUG_POOL_COUNTER
+
+POOL_BASE_TEMPLATE
+CPoolList CPoolBase<POOL_BASE_TEMPLATE_IMPL>::sList = {Reset, ShowUsage, ShowTrace, size, nullptr, nullptr};
+
+POOL_BASE_TEMPLATE
+thread_local CPoolCounterRef CPoolBase<POOL_BASE_TEMPLATE_IMPL>::sCounter(&sList);
+
+POOL_BASE_TEMPLATE
+CPoolCounter CPoolBase<POOL_BASE_TEMPLATE_IMPL>::sBase;
+
+#endif
+
 #ifdef DEBUG_POOL
 
 POOL_BASE_TEMPLATE
@@ -310,38 +1453,35 @@ const char *CPoolBase<POOL_BASE_TEMPLATE_IMPL>::PoolOpsStr[] = {
 	"REAL_ALLOC",
 };
 
-POOL_BASE_TEMPLATE
-CPoolList CPoolBase<POOL_BASE_TEMPLATE_IMPL>::sList = {Reset, ShowUsage, ShowTrace, size, nullptr};
-
 POOL_BASE_TEMPLATE
 typename CPoolBase<POOL_BASE_TEMPLATE_IMPL>::PoolTrace CPoolBase<POOL_BASE_TEMPLATE_IMPL>::sPoolTrace[TRACE_CNT];
 
 POOL_BASE_TEMPLATE
-uint32_t CPoolBase<POOL_BASE_TEMPLATE_IMPL>::sPoolTraceIdx = CPoolStastics<>::RegisterPool(&sList);
+uint32_t CPoolBase<POOL_BASE_TEMPLATE_IMPL>::sPoolTraceIdx = 0;
 
-POOL_BASE_TEMPLATE
-uint32_t CPoolBase<POOL_BASE_TEMPLATE_IMPL>::sRealAlloc = 0;
+#endif
 
 POOL_BASE_TEMPLATE
-uint32_t CPoolBase<POOL_BASE_TEMPLATE_IMPL>::sAlloc = 0;
+constexpr uint32_t CPoolBase<POOL_BASE_TEMPLATE_IMPL>::BLOCK_SIZE;
 
 POOL_BASE_TEMPLATE
-uint32_t CPoolBase<POOL_BASE_TEMPLATE_IMPL>::sFree = 0;
-
-#endif
+CPoolDepot CPoolBase<POOL_BASE_TEMPLATE_IMPL>::sDepot(BLOCK_SIZE, Backend::ChunkSize(BLOCK_SIZE), Backend::Header(), Backend::Map, Backend::Decommit());
 
 POOL_BASE_TEMPLATE
-uint64_t CPoolBase<POOL_BASE_TEMPLATE_IMPL>::sPoolHead = 0;
+thread_local CPoolMagazine CPoolBase<POOL_BASE_TEMPLATE_IMPL>::sMagazine(&sDepot);
 
 #ifdef DEBUG_POOL_ALLOC
-#define DEFINE_POOL_BASE(name, s, type) \
-	static constexpr int _s = s > sizeof(SList) ? s : sizeof(SList); \
-	typedef class CPoolBase<_s, type> name
+#define DEFINE_POOL_BASE_BACKEND(name, s, type, backend) \
+	static constexpr int _s = s > sizeof(CPoolBlock) ? s : sizeof(CPoolBlock); \
+	typedef class CPoolBase<_s, type, backend> name
 #else
-#define DEFINE_POOL_BASE(name, s, type) \
-	static constexpr int _s = s > sizeof(SList) ? s : sizeof(SList); \
-	typedef class CPoolBase<_s> name
+#define DEFINE_POOL_BASE_BACKEND(name, s, type, backend) \
+	static constexpr int _s = s > sizeof(CPoolBlock) ? s : sizeof(CPoolBlock); \
+	typedef class CPoolBase<_s, backend> name
 #endif
 
+#define DEFINE_POOL_BASE(name, s, type) \
+	DEFINE_POOL_BASE_BACKEND(name, s, type, CPoolPageBackend)
+
 #endif /* POOL_BASE_HPP__ */
 
@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __POOL_REPORT_HPP__
+#define __POOL_REPORT_HPP__
+
+#include <String/Json.hpp>
+#include "PoolBase.hpp"
+
+/* Export CPoolTelemetry as json, one object per pool:
+ * {"pools":[{"block":64,"chunk":16384,"chunks":3,...},...]}
+ * The fields are the ones of CPoolUsage. */
+class CPoolReport
+{
+public:
+	static CJsonPtr ToJson(void);
+	static CJsonPtr ToJson(const CPoolUsage &usage);
+};
+
+#endif /* __POOL_REPORT_HPP__ */
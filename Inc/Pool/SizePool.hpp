@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SIZE_POOL_HPP__
+#define __SIZE_POOL_HPP__
+
+#include <Os.hpp>
+#include "MemPool.hpp"
+
+/* Size classes are the powers of 2 and their midpoints:
+ * 24, 32, 48, 64, 96, 128, ..., 32768, 49152, 65536.
+ * 24 is the first one because it is the smallest block of a pool.
+ * Bigger buffers are allocated with new[].
+ * In a CArenaScope all the buffers come from the arena. */
+#define SIZE_POOL_MIN 24
+#define SIZE_POOL_MAX 65536
+#define SIZE_POOL_CLASS_CNT 24
+
+class CSizePool
+{
+public:
+	/* Allocate a buffer of at least size bytes.
+	 * The real size of the buffer is returned by cap. */
+	inline static CMemPtr Alloc(uint32_t size, uint32_t &cap);
+
+	/* The real size Alloc() would give for size */
+	inline static uint32_t GetCapacity(uint32_t size);
+
+	/* Trim all the size classes */
+	inline static void Trim(void);
+
+	static constexpr uint32_t ClassSize(uint32_t idx)
+	{
+		return (idx & 1) ? (1U << ((idx >> 1) + 5)) : (3U << ((idx >> 1) + 3));
+	}
+
+private:
+	struct CSizeClass
+	{
+		CMemPtr (*Alloc)(void);
+		void (*Trim)(void);
+	};
+
+	inline static uint32_t ClassIndex(uint32_t size);
+	inline static const CSizeClass &GetClass(uint32_t idx);
+};
+
+/* =====================================================================
+ *							Implement CSizePool
+ * ===================================================================== */
+inline uint32_t CSizePool::ClassIndex(uint32_t size)
+{
+	if (size <= SIZE_POOL_MIN) {
+		return 0;
+	}
+
+	/* size is in (2^bit, 2^(bit + 1)] */
+	uint32_t bit = BIT_SCAN_REVERSE(size - 1);
+
+	return ((bit - 4) << 1) + (size > (3U << (bit - 1)));
+}
+
+inline const CSizePool::CSizeClass &CSizePool::GetClass(uint32_t idx)
+{
+	#define SIZE_CLASS(idx) { \
+		CMemPool<ClassSize(idx)>::Alloc, \
+		CMemPool<ClassSize(idx)>::Trim, \
+	}
+
+	static const CSizeClass sClasses[SIZE_POOL_CLASS_CNT] = {
+		SIZE_CLASS(0),  SIZE_CLASS(1),  SIZE_CLASS(2),  SIZE_CLASS(3),
+		SIZE_CLASS(4),  SIZE_CLASS(5),  SIZE_CLASS(6),  SIZE_CLASS(7),
+		SIZE_CLASS(8),  SIZE_CLASS(9),  SIZE_CLASS(10), SIZE_CLASS(11),
+		SIZE_CLASS(12), SIZE_CLASS(13), SIZE_CLASS(14), SIZE_CLASS(15),
+		SIZE_CLASS(16), SIZE_CLASS(17), SIZE_CLASS(18), SIZE_CLASS(19),
+		SIZE_CLASS(20), SIZE_CLASS(21), SIZE_CLASS(22), SIZE_CLASS(23),
+	};
+
+	#undef SIZE_CLASS
+
+	return sClasses[idx];
+}
+
+inline CMemPtr CSizePool::Alloc(uint32_t size, uint32_t &cap)
+{
+	CArena *arena = CArena::Current();
+
+	if (nullptr != arena) {
+		cap = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+		char *buf = arena->Alloc(sizeof(CSharedBase<char>) + cap);
+		CSharedBase<char> *base = new (buf) CSharedBase<char>(
+				CArena::Release, nullptr, CArena::Destroy);
+
+		return CMemPtr(buf + sizeof(CSharedBase<char>), base);
+	}
+
+	if (size > SIZE_POOL_MAX) {
+		cap = size;
+		return CMemPtr(new char[size], CMemPtr::ArrayDeleter);
+	}
+
+	uint32_t idx = ClassIndex(size);
+
+	cap = ClassSize(idx);
+	return GetClass(idx).Alloc();
+}
+
+inline uint32_t CSizePool::GetCapacity(uint32_t size)
+{
+	return (size > SIZE_POOL_MAX) ? size : ClassSize(ClassIndex(size));
+}
+
+inline void CSizePool::Trim(void)
+{
+	for (uint32_t i = 0; i < SIZE_POOL_CLASS_CNT; ++i) {
+		GetClass(i).Trim();
+	}
+}
+
+#endif /* __SIZE_POOL_HPP__ */
@@ -0,0 +1,311 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __ATOMIC_SHARED_PTR_HPP__
+#define __ATOMIC_SHARED_PTR_HPP__
+
+/* A CSharedPtr which can be loaded and replaced by many threads.
+ *
+ * It uses a split reference count: the word keeps the base, the
+ * object and the number of readers taking a reference from it.
+ * A reader first increases this local count, so the base cannot
+ * be freed, then adds a real reference and gives the local one
+ * back. A writer replacing the word moves the local count to
+ * the base, and the readers still running release it there.
+ *
+ * The local counts of a base are all moved to it, so a reader
+ * giving one back only looks at the base: the same base may have
+ * been stored again, and a count taken from the new word is one
+ * less moved by the next writer. A count already given back by
+ * another reader is released on the base, never below 0.
+ *
+ * The word is swapped by a double width CAS, the readers never
+ * block. The top bits of the base keep the local count, define
+ * ASPTR_ADDR_BITS to 57 for 5-level paging (a 7 bits count).
+ * Without double width CAS the word is protected by a spin lock. */
+#ifndef ASPTR_ADDR_BITS
+#define ASPTR_ADDR_BITS 48
+#endif
+
+#define ASPTR_ADDR_MASK	((1ULL << ASPTR_ADDR_BITS) - 1)
+#define ASPTR_CNT_MAX	((1ULL << (64 - ASPTR_ADDR_BITS)) - 1)
+
+/* mBase: base and local count, mPtr: object */
+struct alignas(16) CAtomicSharedWord
+{
+	uint64_t mBase;
+	uint64_t mPtr;
+};
+
+template <class T>
+class CAtomicSharedPtr
+{
+private:
+	typedef CAtomicSharedWord Word;
+
+	mutable Word mWord;
+
+#ifndef ATOMIC_HAS_CAS128
+	mutable atomic_t mLock;
+#endif
+
+public:
+	inline CAtomicSharedPtr(std::nullptr_t = nullptr);
+	inline CAtomicSharedPtr(CSharedPtr<T> ptr);
+
+	/* No reader or writer may be running */
+	inline ~CAtomicSharedPtr(void);
+
+	inline CSharedPtr<T> Load(void) const;
+	inline void Store(CSharedPtr<T> ptr);
+
+	/* Replace the pointer and return the old one */
+	inline CSharedPtr<T> Exchange(CSharedPtr<T> ptr);
+
+	/* Replace the pointer if it is the same object as expected.
+	 * Otherwise expected is set to the current pointer. */
+	inline bool CompareExchange(CSharedPtr<T> &expected, CSharedPtr<T> desired);
+
+private:
+	inline static CSharedBase<T> *GetBase(const Word &word);
+	inline static T *GetPtr(const Word &word);
+	inline static uint64_t GetCount(const Word &word);
+	inline static Word MakeWord(CSharedBase<T> *base, T *ptr, uint64_t count);
+
+	/* The 2 halves may be read at different time,
+	 * the CAS fails then and it is read again. */
+	inline Word Read(void) const;
+
+	inline bool CompareAndSwap(const Word &tmp, const Word &word) const;
+
+	/* Take the reference kept by a word replaced. */
+	inline static CSharedPtr<T> Retire(const Word &word);
+
+	inline CAtomicSharedPtr(const CAtomicSharedPtr &);
+	inline CAtomicSharedPtr &operator = (const CAtomicSharedPtr &);
+};
+
+/* =====================================================================
+ *							Implement CAtomicSharedPtr
+ * ===================================================================== */
+template <class T>
+inline CAtomicSharedPtr<T>::CAtomicSharedPtr(std::nullptr_t) :
+	mWord(MakeWord(nullptr, nullptr, 0))
+#ifndef ATOMIC_HAS_CAS128
+	, mLock(0)
+#endif
+{
+	/* Does nothing */
+}
+
+template <class T>
+inline CAtomicSharedPtr<T>::CAtomicSharedPtr(CSharedPtr<T> ptr) :
+	mWord(MakeWord(ptr.mBase, ptr.mPtr, 0))
+#ifndef ATOMIC_HAS_CAS128
+	, mLock(0)
+#endif
+{
+	/* The reference is kept by the word */
+	ptr.mPtr = nullptr;
+	ptr.mBase = nullptr;
+}
+
+template <class T>
+inline CAtomicSharedPtr<T>::~CAtomicSharedPtr(void)
+{
+	Retire(mWord);
+}
+
+template <class T>
+inline CSharedPtr<T> CAtomicSharedPtr<T>::Load(void) const
+{
+	Word tmp, word;
+
+	/* Increase the local count, the base cannot be freed after it.
+	 * With too many readers at the same time, wait for one to finish. */
+	while (true) {
+		tmp = Read();
+		if (nullptr == GetBase(tmp)) {
+			return CSharedPtr<T>(nullptr);
+		}
+
+		word = MakeWord(GetBase(tmp), GetPtr(tmp), GetCount(tmp) + 1);
+
+		if (ASPTR_CNT_MAX != GetCount(tmp) && CompareAndSwap(tmp, word)) {
+			break;
+		}
+	}
+
+	CSharedBase<T> *base = GetBase(word);
+	T *ptr = GetPtr(word);
+
+	base->AddRef();
+
+	/* Give the local count back. If the word has been replaced,
+	 * the writer has moved it to the base, release it there.
+	 * A change is confirmed by a CAS: the 2 halves of tmp may be
+	 * read at different time. */
+	while (true) {
+		tmp = Read();
+
+		if (GetBase(tmp) == base && 0 != GetCount(tmp)) {
+			if (CompareAndSwap(tmp, MakeWord(base, GetPtr(tmp), GetCount(tmp) - 1))) {
+				break;
+			}
+		} else if (CompareAndSwap(tmp, tmp)) {
+			base->ReleaseRef();
+			break;
+		}
+	}
+
+	return CSharedPtr<T>(ptr, base);
+}
+
+template <class T>
+inline void CAtomicSharedPtr<T>::Store(CSharedPtr<T> ptr)
+{
+	Exchange(std::move(ptr));
+}
+
+template <class T>
+inline CSharedPtr<T> CAtomicSharedPtr<T>::Exchange(CSharedPtr<T> ptr)
+{
+	Word tmp;
+
+	do {
+		tmp = Read();
+	} while (!CompareAndSwap(tmp, MakeWord(ptr.mBase, ptr.mPtr, 0)));
+
+	ptr.mPtr = nullptr;
+	ptr.mBase = nullptr;
+
+	return Retire(tmp);
+}
+
+/* expected keeps its base alive, so the base cannot be
+ * freed and reused by another object during the compare. */
+template <class T>
+inline bool CAtomicSharedPtr<T>::CompareExchange(CSharedPtr<T> &expected,
+												 CSharedPtr<T> desired)
+{
+	while (true) {
+		Word tmp = Read();
+
+		if (GetBase(tmp) != expected.mBase || GetPtr(tmp) != expected.mPtr) {
+			/* Not a torn read */
+			if (CompareAndSwap(tmp, tmp)) {
+				expected = Load();
+				return false;
+			}
+
+			continue;
+		}
+
+		if (CompareAndSwap(tmp, MakeWord(desired.mBase, desired.mPtr, 0))) {
+			desired.mPtr = nullptr;
+			desired.mBase = nullptr;
+			Retire(tmp);
+			return true;
+		}
+	}
+}
+
+template <class T>
+inline CSharedBase<T> *CAtomicSharedPtr<T>::GetBase(const Word &word)
+{
+	return (CSharedBase<T> *)(uintptr_t)(word.mBase & ASPTR_ADDR_MASK);
+}
+
+template <class T>
+inline T *CAtomicSharedPtr<T>::GetPtr(const Word &word)
+{
+	return (T *)(uintptr_t)word.mPtr;
+}
+
+template <class T>
+inline uint64_t CAtomicSharedPtr<T>::GetCount(const Word &word)
+{
+	return word.mBase >> ASPTR_ADDR_BITS;
+}
+
+template <class T>
+inline CAtomicSharedWord CAtomicSharedPtr<T>::MakeWord(CSharedBase<T> *base, T *ptr,
+													   uint64_t count)
+{
+	Word word = {
+		(uint64_t)(uintptr_t)base | (count << ASPTR_ADDR_BITS),
+		(uint64_t)(uintptr_t)ptr
+	};
+
+	return word;
+}
+
+template <class T>
+inline CAtomicSharedWord CAtomicSharedPtr<T>::Read(void) const
+{
+	Word word = {
+		ATOMIC_LOAD_EXPLICIT(&mWord.mBase, ATOMIC_RELAXED),
+		ATOMIC_LOAD_EXPLICIT(&mWord.mPtr, ATOMIC_RELAXED)
+	};
+
+	return word;
+}
+
+#ifdef ATOMIC_HAS_CAS128
+template <class T>
+inline bool CAtomicSharedPtr<T>::CompareAndSwap(const Word &tmp, const Word &word) const
+{
+	return ATOMIC_COMPARE_AND_SWAP128(&mWord,
+		ATOMIC_MAKE128(tmp.mBase, tmp.mPtr),
+		ATOMIC_MAKE128(word.mBase, word.mPtr));
+}
+#else
+template <class T>
+inline bool CAtomicSharedPtr<T>::CompareAndSwap(const Word &tmp, const Word &word) const
+{
+	while (!ATOMIC_COMPARE_AND_SWAP(&mLock, 0, 1)) {
+		/* Spin */
+	}
+
+	bool ret = (mWord.mBase == tmp.mBase && mWord.mPtr == tmp.mPtr);
+	if (ret) {
+		mWord = word;
+	}
+
+	ATOMIC_COMPARE_AND_SWAP(&mLock, 1, 0);
+
+	return ret;
+}
+#endif
+
+template <class T>
+inline CSharedPtr<T> CAtomicSharedPtr<T>::Retire(const Word &word)
+{
+	CSharedBase<T> *base = GetBase(word);
+
+	if (nullptr == base) {
+		return CSharedPtr<T>(nullptr);
+	}
+
+	/* The readers still running release these */
+	if (0 != GetCount(word)) {
+		base->TransferRef((uint32_t)GetCount(word));
+	}
+
+	return CSharedPtr<T>(GetPtr(word), base);
+}
+
+#endif /* __ATOMIC_SHARED_PTR_HPP__ */
@@ -25,20 +25,39 @@ class CSharedPtr;
 template <class T>
 class CWeakPtr;
 
+template <class T>
+class CIntrusivePtr;
+
 HAS_MEMBER(ImEnableSharedPtr);
 #define HAS_ENABLE_SHARED_PTR(T) \
 	has_derived_member_ImEnableSharedPtr<T, CEnableSharedPtr<REMOVE_CONST(T)>>
 
+/* The object keeps a plain pointer to its CSharedBase instead of
+ * a weak reference: the base is freed after the object is destroyed,
+ * so it is valid as long as the object is. Share() fails once the
+ * object is being destroyed. An object must be owned by only one
+ * CSharedBase. CIntrusivePtr reaches the counters through it.
+ *
+ * The CSharedPtr given by Share() may go to another thread, so
+ * the base of an object made by MakeLocalShared() is published
+ * first, like CLocalSharedPtr::Publish(). Only the thread owning
+ * a local object can reach it, so this is safe. */
 template <class T>
 class CEnableSharedPtr
 {
 private:
-	CWeakPtr<T> mInst;
-	mutable CWeakPtr<const T> mConstInst;
+	mutable CSharedBase<T> *mBase;
+
+	template <class T1>
+	friend class CIntrusivePtr;
 
 protected:
 	inline CEnableSharedPtr(void);
 
+	/* A copy is a new object: it is not shared yet. */
+	inline CEnableSharedPtr(const CEnableSharedPtr &);
+	inline CEnableSharedPtr &operator = (const CEnableSharedPtr &);
+
 public:
 	template <class T1,
 			 DEBUG_TEMPLATE,
@@ -67,12 +86,27 @@ private:
  * =====================================================================
  */
 template <class T>
-inline CEnableSharedPtr<T>::CEnableSharedPtr(void)
+inline CEnableSharedPtr<T>::CEnableSharedPtr(void) :
+	mBase(nullptr)
 {
 	SPTR_DEBUG(ENSPTR_HEAD() SPTR_PTR " default construct",
 			   TYPE_NAME(T), this);
 }
 
+template <class T>
+inline CEnableSharedPtr<T>::CEnableSharedPtr(const CEnableSharedPtr &) :
+	mBase(nullptr)
+{
+	SPTR_DEBUG(ENSPTR_HEAD() SPTR_PTR " copy construct",
+			   TYPE_NAME(T), this);
+}
+
+template <class T>
+inline CEnableSharedPtr<T> &CEnableSharedPtr<T>::operator = (const CEnableSharedPtr &)
+{
+	return *this;
+}
+
 template <class T>
 template <class T1,
 		 DECLARE_DEBUG_TEMPLATE,
@@ -83,8 +117,7 @@ inline void CEnableSharedPtr<T>::SetShared(const CSharedPtr<T1> &ptr) const
 	SPTR_DEBUG_ENTRY(ENSPTR_HEAD() SPTR_PTR " SetShared const " SPTR_HEAD() SPTR_PTR,
 					 TYPE_NAME(T), this, TYPE_NAME(T1), &ptr);
 
-	Dump();
-	mConstInst = ptr;
+	mBase = (CSharedBase<T> *)ptr.mBase;
 	Dump();
 
 	SPTR_DEBUG_EXIT(ENSPTR_HEAD() SPTR_PTR " SetShared const " SPTR_HEAD() SPTR_PTR,
@@ -101,9 +134,7 @@ inline void CEnableSharedPtr<T>::SetShared(const CSharedPtr<T1> &ptr)
 	SPTR_DEBUG_ENTRY(ENSPTR_HEAD() SPTR_PTR " SetShared " SPTR_HEAD() SPTR_PTR,
 					 TYPE_NAME(T), this, TYPE_NAME(T1), &ptr);
 
-	Dump();
-	mInst = ptr;
-	mConstInst = ptr;
+	mBase = (CSharedBase<T> *)ptr.mBase;
 	Dump();
 
 	SPTR_DEBUG_EXIT(ENSPTR_HEAD() SPTR_PTR " SetShared " SPTR_HEAD() SPTR_PTR,
@@ -115,11 +146,18 @@ inline CSharedPtr<T> CEnableSharedPtr<T>::Share(void)
 {
 	SPTR_DEBUG_ENTRY(ENSPTR_HEAD() SPTR_PTR " share", TYPE_NAME(T), this);
 
-	auto ret = mInst.Lock();
+	if (nullptr != mBase && mBase->IsLocal()) {
+		mBase->Publish();
+	}
+
+	if (nullptr == mBase || !mBase->Lock()) {
+		SPTR_DEBUG_EXIT(ENSPTR_HEAD() SPTR_PTR " share(N)", TYPE_NAME(T), this);
+		return CSharedPtr<T>(nullptr);
+	}
 
 	SPTR_DEBUG_EXIT(ENSPTR_HEAD() SPTR_PTR " share", TYPE_NAME(T), this);
 
-	return ret;
+	return CSharedPtr<T>(static_cast<T *>(this), mBase);
 }
 
 template <class T>
@@ -127,18 +165,26 @@ inline CSharedPtr<const T> CEnableSharedPtr<T>::Share(void) const
 {
 	SPTR_DEBUG_ENTRY(ENSPTR_HEAD() SPTR_PTR " share const", TYPE_NAME(T), this);
 
-	auto ret = mConstInst.Lock();
+	if (nullptr != mBase && mBase->IsLocal()) {
+		mBase->Publish();
+	}
+
+	if (nullptr == mBase || !mBase->Lock()) {
+		SPTR_DEBUG_EXIT(ENSPTR_HEAD() SPTR_PTR " share const(N)", TYPE_NAME(T), this);
+		return CSharedPtr<const T>(nullptr);
+	}
 
 	SPTR_DEBUG_EXIT(ENSPTR_HEAD() SPTR_PTR " share const", TYPE_NAME(T), this);
 
-	return ret;
+	return CSharedPtr<const T>(static_cast<const T *>(this),
+							   (CSharedBase<const T> *)mBase);
 }
 
 template <class T>
 inline void CEnableSharedPtr<T>::Dump(void) const
 {
-	SPTR_DUMP("Addr: %p mInst: %p, mConstInst: %p, Type: %s",
-			  this, &mInst, &mConstInst, TYPE_NAME(T));
+	SPTR_DUMP("Addr: %p mBase: %p, Type: %s",
+			  this, mBase, TYPE_NAME(T));
 }
 
 #endif /* __ENABLE_SHARED_PTR_HPP__ */
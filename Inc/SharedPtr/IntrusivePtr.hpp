@@ -0,0 +1,326 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __INTRUSIVE_PTR_HPP__
+#define __INTRUSIVE_PTR_HPP__
+
+/* Single pointer reference to a CEnableSharedPtr object.
+ * The counters are reached through the object: it keeps the
+ * CSharedBase it is owned by, which MakeShared() places right
+ * in front of it. So it is half the size of a CSharedPtr and
+ * copying it does not load a second pointer. For the links
+ * kept inside a structure (CJson children and siblings).
+ *
+ * It is made from a CSharedPtr and converted back implicitly,
+ * the object must be owned by a CSharedPtr. There is no weak
+ * reference from it, use CWeakPtr on the CSharedPtr. */
+template <class T>
+class CIntrusivePtr
+{
+private:
+	typedef REMOVE_CONST(T) Obj;
+	typedef CSharedBase<Obj> Base;
+
+	T *mPtr;
+
+public:
+	inline CIntrusivePtr(void);
+	inline CIntrusivePtr(std::nullptr_t);
+	inline CIntrusivePtr(const CIntrusivePtr &ptr);
+	inline CIntrusivePtr(CIntrusivePtr &&ptr);
+
+	/* A reference is added */
+	template <class T1,
+			 ENABLE_IF(IS_STATICALLY_ASSIGNABLE(T, T1))>
+	inline CIntrusivePtr(const CSharedPtr<T1> &ptr);
+
+	/* The reference of ptr is taken over */
+	template <class T1,
+			 ENABLE_IF(IS_STATICALLY_ASSIGNABLE(T, T1))>
+	inline CIntrusivePtr(CSharedPtr<T1> &&ptr);
+
+	inline ~CIntrusivePtr(void);
+
+	inline CIntrusivePtr &operator = (const CIntrusivePtr &ptr);
+	inline CIntrusivePtr &operator = (CIntrusivePtr &&ptr);
+	inline CIntrusivePtr &operator = (std::nullptr_t);
+
+	template <class T1,
+			 ENABLE_IF(IS_STATICALLY_ASSIGNABLE(T, T1))>
+	inline CIntrusivePtr &operator = (const CSharedPtr<T1> &ptr);
+
+	template <class T1,
+			 ENABLE_IF(IS_STATICALLY_ASSIGNABLE(T, T1))>
+	inline CIntrusivePtr &operator = (CSharedPtr<T1> &&ptr);
+
+	/* A reference is added for the CSharedPtr */
+	template <class T1,
+			 ENABLE_IF(IS_STATICALLY_ASSIGNABLE(T1, T))>
+	inline operator CSharedPtr<T1>(void) const;
+
+	inline bool operator == (const CIntrusivePtr &ptr) const;
+	inline bool operator != (const CIntrusivePtr &ptr) const;
+	inline bool operator == (std::nullptr_t) const;
+	inline bool operator != (std::nullptr_t) const;
+
+	inline explicit operator bool(void) const;
+	inline T *operator -> (void) const;
+	inline T &operator * (void) const;
+
+	inline T *Get(void) const;
+	inline void Swap(CIntrusivePtr &ptr);
+	inline void Release(void);
+
+	inline uint32_t GetRef(void) const;
+
+private:
+	inline static Base *GetBase(T *ptr);
+};
+
+/* Help function to create an object and a CIntrusivePtr to it */
+template <class T, class... Args>
+inline CIntrusivePtr<T> MakeIntrusive(Args && ... args);
+
+/* =====================================================================
+ *							Implement CIntrusivePtr
+ * ===================================================================== */
+template <class T>
+inline CIntrusivePtr<T>::CIntrusivePtr(void) :
+	mPtr(nullptr)
+{
+	/* Does nothing */
+}
+
+template <class T>
+inline CIntrusivePtr<T>::CIntrusivePtr(std::nullptr_t) :
+	mPtr(nullptr)
+{
+	/* Does nothing */
+}
+
+template <class T>
+inline CIntrusivePtr<T>::CIntrusivePtr(const CIntrusivePtr &ptr) :
+	mPtr(ptr.mPtr)
+{
+	if (nullptr != mPtr) {
+		GetBase(mPtr)->AddRef();
+	}
+}
+
+template <class T>
+inline CIntrusivePtr<T>::CIntrusivePtr(CIntrusivePtr &&ptr) :
+	mPtr(ptr.mPtr)
+{
+	ptr.mPtr = nullptr;
+}
+
+template <class T>
+template <class T1,
+		 DECLARE_ENABLE_IF(IS_STATICALLY_ASSIGNABLE(T, T1))>
+inline CIntrusivePtr<T>::CIntrusivePtr(const CSharedPtr<T1> &ptr) :
+	mPtr(ptr.mPtr)
+{
+	if (nullptr != mPtr) {
+		ptr.mBase->AddRef();
+	}
+}
+
+template <class T>
+template <class T1,
+		 DECLARE_ENABLE_IF(IS_STATICALLY_ASSIGNABLE(T, T1))>
+inline CIntrusivePtr<T>::CIntrusivePtr(CSharedPtr<T1> &&ptr) :
+	mPtr(ptr.mPtr)
+{
+	ptr.mPtr = nullptr;
+	ptr.mBase = nullptr;
+}
+
+template <class T>
+inline CIntrusivePtr<T>::~CIntrusivePtr(void)
+{
+	Release();
+}
+
+template <class T>
+inline CIntrusivePtr<T> &CIntrusivePtr<T>::operator = (const CIntrusivePtr &ptr)
+{
+	/* Added first, ptr may be owned by the released object */
+	if (nullptr != ptr.mPtr) {
+		GetBase(ptr.mPtr)->AddRef();
+	}
+
+	Release();
+	mPtr = ptr.mPtr;
+
+	return *this;
+}
+
+template <class T>
+inline CIntrusivePtr<T> &CIntrusivePtr<T>::operator = (CIntrusivePtr &&ptr)
+{
+	T *tmp = ptr.mPtr;
+
+	ptr.mPtr = nullptr;
+	Release();
+	mPtr = tmp;
+
+	return *this;
+}
+
+template <class T>
+inline CIntrusivePtr<T> &CIntrusivePtr<T>::operator = (std::nullptr_t)
+{
+	Release();
+
+	return *this;
+}
+
+template <class T>
+template <class T1,
+		 DECLARE_ENABLE_IF(IS_STATICALLY_ASSIGNABLE(T, T1))>
+inline CIntrusivePtr<T> &CIntrusivePtr<T>::operator = (const CSharedPtr<T1> &ptr)
+{
+	if (nullptr != ptr.mPtr) {
+		ptr.mBase->AddRef();
+	}
+
+	Release();
+	mPtr = ptr.mPtr;
+
+	return *this;
+}
+
+template <class T>
+template <class T1,
+		 DECLARE_ENABLE_IF(IS_STATICALLY_ASSIGNABLE(T, T1))>
+inline CIntrusivePtr<T> &CIntrusivePtr<T>::operator = (CSharedPtr<T1> &&ptr)
+{
+	T *tmp = ptr.mPtr;
+
+	ptr.mPtr = nullptr;
+	ptr.mBase = nullptr;
+	Release();
+	mPtr = tmp;
+
+	return *this;
+}
+
+template <class T>
+template <class T1,
+		 DECLARE_ENABLE_IF(IS_STATICALLY_ASSIGNABLE(T1, T))>
+inline CIntrusivePtr<T>::operator CSharedPtr<T1>(void) const
+{
+	CSharedPtr<T1> ret(nullptr);
+
+	if (nullptr != mPtr) {
+		ret.mPtr = mPtr;
+		ret.mBase = GetBase(mPtr)->template AddRef<T1>();
+	}
+
+	return ret;
+}
+
+template <class T>
+inline bool CIntrusivePtr<T>::operator == (const CIntrusivePtr &ptr) const
+{
+	return mPtr == ptr.mPtr;
+}
+
+template <class T>
+inline bool CIntrusivePtr<T>::operator != (const CIntrusivePtr &ptr) const
+{
+	return mPtr != ptr.mPtr;
+}
+
+template <class T>
+inline bool CIntrusivePtr<T>::operator == (std::nullptr_t) const
+{
+	return nullptr == mPtr;
+}
+
+template <class T>
+inline bool CIntrusivePtr<T>::operator != (std::nullptr_t) const
+{
+	return nullptr != mPtr;
+}
+
+template <class T>
+inline CIntrusivePtr<T>::operator bool(void) const
+{
+	return nullptr != mPtr;
+}
+
+template <class T>
+inline T *CIntrusivePtr<T>::operator -> (void) const
+{
+	if (nullptr == mPtr) {
+		throw ES("CIntrusivePtr is empty");
+	}
+
+	return mPtr;
+}
+
+template <class T>
+inline T &CIntrusivePtr<T>::operator * (void) const
+{
+	return *operator -> ();
+}
+
+template <class T>
+inline T *CIntrusivePtr<T>::Get(void) const
+{
+	return operator -> ();
+}
+
+template <class T>
+inline void CIntrusivePtr<T>::Swap(CIntrusivePtr &ptr)
+{
+	T *tmp = mPtr;
+
+	mPtr = ptr.mPtr;
+	ptr.mPtr = tmp;
+}
+
+template <class T>
+inline void CIntrusivePtr<T>::Release(void)
+{
+	if (nullptr != mPtr) {
+		Base *base = GetBase(mPtr);
+
+		mPtr = nullptr;
+		base->ReleaseRef();
+	}
+}
+
+template <class T>
+inline uint32_t CIntrusivePtr<T>::GetRef(void) const
+{
+	return (nullptr == mPtr) ? 0 : GetBase(mPtr)->GetRef();
+}
+
+template <class T>
+inline typename CIntrusivePtr<T>::Base *CIntrusivePtr<T>::GetBase(T *ptr)
+{
+	return static_cast<const CEnableSharedPtr<Obj> *>(ptr)->mBase;
+}
+
+template <class T, class... Args>
+inline CIntrusivePtr<T> MakeIntrusive(Args && ... args)
+{
+	return CIntrusivePtr<T>(MakeShared<T>(std::forward<decltype(args)>(args)...));
+}
+
+#endif /* __INTRUSIVE_PTR_HPP__ */
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __LOCAL_SHARED_PTR_HPP__
+#define __LOCAL_SHARED_PTR_HPP__
+
+/* CSharedPtr whose object is used by only one thread.
+ * The counters are changed by plain increments instead of atomics.
+ *
+ * It cannot be converted to a CSharedPtr implicitly: Publish()
+ * switches the object to atomic counters, it must be called by
+ * the thread owning the object before giving it to another one.
+ * All the copies (local or not) are safe after Publish(). */
+template <class T>
+class CLocalSharedPtr :
+	private CSharedPtr<T>
+{
+	typedef CSharedPtr<T> Base;
+
+	template <class T1, class... Args>
+	friend CLocalSharedPtr<T1> MakeLocalShared(Args && ... args);
+
+public:
+	inline CLocalSharedPtr(std::nullptr_t) :
+		Base(nullptr)
+	{
+		/* Does nothing */
+	}
+
+	inline CLocalSharedPtr(const CLocalSharedPtr &ptr) = default;
+	inline CLocalSharedPtr(CLocalSharedPtr &&ptr) = default;
+	inline CLocalSharedPtr &operator = (const CLocalSharedPtr &ptr) = default;
+	inline CLocalSharedPtr &operator = (CLocalSharedPtr &&ptr) = default;
+
+	inline CLocalSharedPtr &operator = (std::nullptr_t)
+	{
+		Base::operator = (nullptr);
+		return *this;
+	}
+
+	/* Switch to atomic counters and get a CSharedPtr. */
+	inline CSharedPtr<T> Publish(void) const
+	{
+		if (nullptr != Base::mBase) {
+			Base::mBase->Publish();
+		}
+
+		return *(const Base *)this;
+	}
+
+	inline explicit operator bool(void) const
+	{
+		return nullptr != Base::mPtr;
+	}
+
+	inline bool IsLocal(void) const
+	{
+		return nullptr != Base::mBase && Base::mBase->IsLocal();
+	}
+
+	using Base::operator ->;
+	using Base::operator *;
+	using Base::operator [];
+	using Base::operator ();
+	using Base::operator ==;
+	using Base::Release;
+	using Base::Get;
+	using Base::GetRef;
+	using Base::GetWeakRef;
+
+private:
+	inline explicit CLocalSharedPtr(Base &&ptr) :
+		Base(std::move(ptr))
+	{
+		if (nullptr != Base::mBase) {
+			Base::mBase->SetLocal();
+		}
+	}
+};
+
+/* Like MakeShared() but the object is only used by the calling thread. */
+template <class T, class... Args>
+inline CLocalSharedPtr<T> MakeLocalShared(Args && ... args)
+{
+	return CLocalSharedPtr<T>(MakeShared<T>(std::forward<decltype(args)>(args)...));
+}
+
+#endif /* __LOCAL_SHARED_PTR_HPP__ */
@@ -20,9 +20,11 @@
 #include <Function/FuncImpl.hpp>
 #include <Platform/PlatformHeader.hpp>
 #include <Pool/PoolBase.hpp>
+#include <Pool/Arena.hpp>
 
 #include "SharedDebug.hpp"
 #include "SharedMeta.hpp"
+#include "SharedRetire.hpp"
 
 template <class T>
 class CSharedPtr;
@@ -30,6 +32,10 @@ class CSharedPtr;
 template <class T>
 class CWeakPtr;
 
+/* The top bit of mRef marks a base used by a single thread
+ * (see CLocalSharedPtr): its counters are changed without atomics. */
+#define SBASE_LOCAL 0x80000000U
+
 template <class T>
 class CSharedBase
 {
@@ -62,6 +68,9 @@ public:
 
 	inline void ReleaseRef(void);
 
+	/* Add count references at once, for CAtomicSharedPtr */
+	inline void TransferRef(uint32_t count) const;
+
 	template <class T1 = T,
 			 DEBUG_TEMPLATE,
 			 ENABLE_IF(MAYBE_ASSIGNABLE(T1, T))>
@@ -71,7 +80,21 @@ public:
 
 	inline bool Lock(void) const;
 
+	inline uint32_t GetRef(void) const;
+	inline uint32_t GetWeakRef(void) const;
+
+	/* Only called by the thread creating the base, before it is shared */
+	inline void SetLocal(void);
+
+	/* Switch to atomic counters before sharing with other threads */
+	inline void Publish(void);
+
+	inline bool IsLocal(void) const;
+
 private:
+	/* Destroy the object of a base retired by CSharedRetire */
+	inline static void Reclaim(void *base);
+
 	inline CSharedBase(CSharedBase &);
 	inline CSharedBase(CSharedBase &&);
 	inline CSharedBase *operator =(CSharedBase &);
@@ -105,53 +128,100 @@ template <class T1,
 		 DECLARE_ENABLE_IF(MAYBE_ASSIGNABLE(T1, T))>
 inline CSharedBase<T1> *CSharedBase<T>::AddRef(void) const
 {
-	auto ref = ATOMIC_ADD_AND_FETCH(&mRef, 1);
+	SPTR_COUNT_REF(true);
+
+	/* A new reference is made from an existing one,
+	 * nothing needs to be ordered. */
+	auto ref = IsLocal() ? ++mRef :
+		ATOMIC_ADD_AND_FETCH_EXPLICIT(&mRef, 1, ATOMIC_RELAXED);
 
 	SPTR_DEBUG(SBASE_HEAD() SPTR_PTR " Add Ref: "
 			   SPTR_INT " => " SPTR_INT " " SBASE_HEAD(),
 			   TYPE_NAME(T), this, ref - 1, ref, TYPE_NAME(T1));
 
+	/* Only used by the trace */
+	(void)ref;
+
 	return (CSharedBase<T1> *)this;
 }
 
 template <class T>
 inline void CSharedBase<T>::ReleaseRef(void)
 {
-	auto ref = ATOMIC_SUB_AND_FETCH(&mRef, 1);
+	SPTR_COUNT_REF(false);
+
+	/* The uses of the object by this thread happen before the
+	 * release, and the deleter sees all of them by the fence. */
+	auto ref = IsLocal() ? --mRef :
+		ATOMIC_SUB_AND_FETCH_EXPLICIT(&mRef, 1, ATOMIC_RELEASE);
 
 	SPTR_DEBUG(SBASE_HEAD() SPTR_PTR " Release Ref: " SPTR_INT " => " SPTR_INT " ",
 			   TYPE_NAME(T), this, ref + 1, ref);
 
-	if (0 == ref) {
-		mObjDelFn(mObj);
-		ReleaseWeakRef();
+	if (0 == (ref & ~SBASE_LOCAL)) {
+		ATOMIC_FENCE(ATOMIC_ACQUIRE);
+
+		if (!CSharedRetire::Retire(this, Reclaim)) {
+			mObjDelFn(mObj);
+			ReleaseWeakRef();
+		}
 	}
 }
 
+template <class T>
+inline void CSharedBase<T>::Reclaim(void *base)
+{
+	CSharedBase<T> *self = (CSharedBase<T> *)base;
+
+	self->mObjDelFn(self->mObj);
+	self->ReleaseWeakRef();
+}
+
+/* The references are handed over by a thread holding one,
+ * nothing needs to be ordered like AddRef(). */
+template <class T>
+inline void CSharedBase<T>::TransferRef(uint32_t count) const
+{
+	auto ref = IsLocal() ? (mRef += count) :
+		ATOMIC_ADD_AND_FETCH_EXPLICIT(&mRef, count, ATOMIC_RELAXED);
+
+	SPTR_DEBUG(SBASE_HEAD() SPTR_PTR " Transfer Ref: " SPTR_INT " => " SPTR_INT " ",
+			   TYPE_NAME(T), this, ref - count, ref);
+
+	/* Only used by the trace */
+	(void)ref;
+}
+
 template <class T>
 template <class T1,
 		 DECLARE_DEBUG_TEMPLATE,
 		 DECLARE_ENABLE_IF(MAYBE_ASSIGNABLE(T1, T))>
 inline CSharedBase<T1> *CSharedBase<T>::AddWeakRef(void) const
 {
-	auto ref = ATOMIC_ADD_AND_FETCH(&mWeakRef, 1);
+	auto ref = IsLocal() ? ++mWeakRef :
+		ATOMIC_ADD_AND_FETCH_EXPLICIT(&mWeakRef, 1, ATOMIC_RELAXED);
 
 	SPTR_DEBUG(SBASE_HEAD() SPTR_PTR " Add wRef: "
 			   SPTR_INT " => " SPTR_INT " " SBASE_HEAD(),
 			   TYPE_NAME(T), this, ref - 1, ref, TYPE_NAME(T1));
 
+	/* Only used by the trace */
+	(void)ref;
+
 	return (CSharedBase<T1> *)this;
 }
 
 template <class T>
 inline void CSharedBase<T>::ReleaseWeakRef(void)
 {
-	auto ref = ATOMIC_SUB_AND_FETCH(&mWeakRef, 1);
+	auto ref = IsLocal() ? --mWeakRef :
+		ATOMIC_SUB_AND_FETCH_EXPLICIT(&mWeakRef, 1, ATOMIC_RELEASE);
 
 	SPTR_DEBUG(SBASE_HEAD() SPTR_PTR " Release Ref: " SPTR_INT " => " SPTR_INT " ",
 			   TYPE_NAME(T), this, ref + 1, ref);
 
 	if (0 == ref) {
+		ATOMIC_FENCE(ATOMIC_ACQUIRE);
 		mBaseDelFn((char *)this);
 	}
 }
@@ -166,20 +236,62 @@ inline bool CSharedBase<T>::Lock(void) const
 	 *		++mRef;
 	 * }
 	 */
+	/* Acquire on success: the object is used after the lock. */
+	SPTR_COUNT_REF(true);
+
 	while (true) {
-		uint32_t tmp = mRef;
+		uint32_t tmp = ATOMIC_LOAD_EXPLICIT(&mRef, ATOMIC_RELAXED);
 
-		if (0 == tmp) {
+		if (0 == (tmp & ~SBASE_LOCAL)) {
 			SPTR_DEBUG_EXIT(SBASE_HEAD() SPTR_PTR " lock fail", TYPE_NAME(T), this);
 			return false;
 		}
 
-		if (ATOMIC_COMPARE_AND_SWAP(&mRef, tmp, tmp + 1)) {
+		if (IsLocal()) {
+			++mRef;
+			SPTR_DEBUG_EXIT(SBASE_HEAD() SPTR_PTR " lock ok", TYPE_NAME(T), this);
+			return true;
+		}
+
+		if (ATOMIC_COMPARE_AND_SWAP_EXPLICIT(&mRef, tmp, tmp + 1,
+											 ATOMIC_ACQUIRE, ATOMIC_RELAXED)) {
 			SPTR_DEBUG_EXIT(SBASE_HEAD() SPTR_PTR " lock ok", TYPE_NAME(T), this);
 			return true;
 		}
 	}
 }
 
+template <class T>
+inline uint32_t CSharedBase<T>::GetRef(void) const
+{
+	return mRef & ~SBASE_LOCAL;
+}
+
+template <class T>
+inline uint32_t CSharedBase<T>::GetWeakRef(void) const
+{
+	return mWeakRef;
+}
+
+template <class T>
+inline void CSharedBase<T>::SetLocal(void)
+{
+	mRef |= SBASE_LOCAL;
+}
+
+/* The other threads can only get the base after this, through a
+ * synchronized channel. So a plain store is enough. */
+template <class T>
+inline void CSharedBase<T>::Publish(void)
+{
+	mRef &= ~SBASE_LOCAL;
+}
+
+template <class T>
+inline bool CSharedBase<T>::IsLocal(void) const
+{
+	return 0 != (ATOMIC_LOAD_EXPLICIT(&mRef, ATOMIC_RELAXED) & SBASE_LOCAL);
+}
+
 #endif /* __SHARED_BASE_HPP__ */
 
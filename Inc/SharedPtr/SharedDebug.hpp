@@ -23,7 +23,48 @@
 #include <Debug/TypeDebug.hpp>
 #include <Common/Common.hpp>
 
+/* CSharedPtr tracing, set by DEBUG_SPTR in the Makefile:
+ *   0: Compiled out, no check nor branch in the CSharedPtr operations.
+ *   1: The checks and the traces enabled by SHARED_PTR_START_DEBUG().
+ *   2: Plus the AddRef()/ReleaseRef() counted per call site,
+ *      shown by SHARED_PTR_SHOW_REF_COUNT(). */
+#ifndef DEBUG_SPTR_LEVEL
+#define DEBUG_SPTR_LEVEL 0
+#endif
+
+#if DEBUG_SPTR_LEVEL >= 1
 #define DEBUG_SPTR
+#endif
+
+#if DEBUG_SPTR_LEVEL >= 2
+#define DEBUG_SPTR_COUNT
+#endif
+
+#ifdef DEBUG_SPTR_COUNT
+
+/* The call site is the first caller in the backtrace
+ * out of the CSharedPtr classes. Slow, only for profiling. */
+#define SPTR_COUNT_REF(add) SharedPtrCountRef(add)
+
+#define SHARED_PTR_SHOW_REF_COUNT() SharedPtrShowRefCount()
+#define SHARED_PTR_RESET_REF_COUNT() SharedPtrResetRefCount()
+
+void SharedPtrCountRef(bool add);
+
+/* Sites sorted by the number of operations, the top ones are shown */
+void SharedPtrShowRefCount(uint32_t top = 32);
+void SharedPtrResetRefCount(void);
+
+/* Total of all the sites */
+void SharedPtrGetRefCount(uint64_t &addRef, uint64_t &releaseRef);
+
+#else /* !DEBUG_SPTR_COUNT */
+
+#define SPTR_COUNT_REF(add)
+#define SHARED_PTR_SHOW_REF_COUNT()
+#define SHARED_PTR_RESET_REF_COUNT()
+
+#endif /* DEBUG_SPTR_COUNT */
 
 #ifdef DEBUG_SPTR
 
@@ -160,14 +201,21 @@ public:
 #define SPTR_PRINT(fmt, ...)
 #define SPTR_VARIADIC_PRINT(fmt, data)
 #define SPTR_DUMP(fmt, ...)
-#define SPTR_HEAD
+#define SPTR_PTR
+#define SPTR_LONG
+#define SPTR_INT
+#define SPTR_TYPE(...)
+#define SPTR_HEAD(...)
 #define ENSPTR_HEAD(...)
 #define WPTR_HEAD(...)
 #define SBASE_HEAD(...)
 #define SHARED_PTR_CHECK()
+#define SHARED_PTR_CHECK_DESTRUCTOR()
 #define WEAK_PTR_CHECK()
+#define WEAK_PTR_CHECK_DESTRUCTOR()
 #define SHARED_PTR_START_DEBUG()
 #define SHARED_PTR_STOP_DEBUG()
+
 class CSharedPtrEnableDebug
 {
 };
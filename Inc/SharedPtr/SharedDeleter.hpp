@@ -85,29 +85,16 @@ private:
 	}
 };
 
+/* Used by MakeShared(): the object is in the block of its
+ * CSharedBase, so it is only destroyed. The CSharedBase saves
+ * the object itself, no deleter is stored. */
 template <class T>
 class CSharedDefaultDeleter
 {
-private:
-	T *mPtr;
-
 public:
-	inline CSharedDefaultDeleter(T *ptr) :
-		mPtr(ptr)
-	{
-		/* Does nothing */
-	}
-
 	inline static void Delete(void *_ptr)
 	{
-		auto deleter = (CSharedDefaultDeleter *)_ptr;
-		deleter->DoDelete();
-	}
-
-private:
-	inline void DoDelete(void)
-	{
-		mPtr->T::~T();
+		((T *)_ptr)->T::~T();
 	}
 };
 
@@ -23,10 +23,53 @@
 #include "SharedToken.hpp"
 #include "SharedDeleter.hpp"
 
-/* Help function to create a CSharedPtr. */
+/* Layout of the block allocated by MakeShared(): the CSharedBase
+ * at the start and the object at OFFSET, both correctly aligned.
+ *
+ * When isolated, the object starts on the next cache line and the
+ * block is padded to a cache line, so the counters do not share a
+ * line with the object or the neighbour blocks. */
+template <class T, bool isolated = false>
+struct CSharedLayout
+{
+	static constexpr uint32_t OBJ_ALIGN =
+		(isolated && alignof(T) < POOL_CACHE_LINE) ? POOL_CACHE_LINE : alignof(T);
+
+	static constexpr uint32_t ALIGN =
+		OBJ_ALIGN > alignof(CSharedBase<T>) ? OBJ_ALIGN : alignof(CSharedBase<T>);
+
+	static constexpr uint32_t OFFSET =
+		(sizeof(CSharedBase<T>) + OBJ_ALIGN - 1) & ~(OBJ_ALIGN - 1);
+
+	static constexpr uint32_t SIZE = OFFSET + sizeof(T);
+
+	/* The page backend only aligns to a pointer */
+	typedef typename std::conditional<(ALIGN <= sizeof(void *)),
+			CPoolPageBackend, CPoolAlignedBackend<ALIGN>>::type Backend;
+};
+
+/* Help function to create a CSharedPtr. An is_arena_object
+ * is created in the current CArena if there is one. */
 template <class T, class... Args>
 inline CSharedPtr<T> MakeShared(Args && ... args);
 
+/* Like MakeShared(), but the counters are on their own cache line.
+ * For the objects modified by one thread while the others copy
+ * the CSharedPtr. It is never created in the arena. */
+template <class T, class... Args>
+inline CSharedPtr<T> MakeIsolatedShared(Args && ... args);
+
+/* Help function to create a CSharedPtr in the arena.
+ * The destructor of T is never called. */
+template <class T, class... Args>
+inline CSharedPtr<T> MakeArenaShared(CArena &arena, Args && ... args);
+
+template <class T>
+class CLocalSharedPtr;
+
+template <class T>
+class CAtomicSharedPtr;
+
 template <class T>
 class CSharedPtr
 {
@@ -101,6 +144,21 @@ public:
 	/* Constructor from token */
 	inline CSharedPtr(const CSharedToken<T> *token);
 
+	/* Adds reference and return the CSharedBase as the token,
+	 * nothing is allocated. If the object is seen through a cast
+	 * (it is not the one kept by the base), a CSharedToken<T> is
+	 * used instead. It must be given back to TakeToken(), or to
+	 * BorrowToken() and then ReleaseToken(). */
+	inline void *ToBaseToken(void) const;
+
+	/* The reference of the token is moved to the CSharedPtr */
+	inline static CSharedPtr<T> TakeToken(void *token);
+
+	/* The token is still valid after it */
+	inline static CSharedPtr<T> BorrowToken(void *token);
+
+	inline static void ReleaseToken(void *token);
+
 public: /* operator = */
 	/* operator = nullptr */
 	inline CSharedPtr<T> &operator = (std::nullptr_t);
@@ -369,6 +427,18 @@ private: /* Friends */
 
 	template <class T1>
 	friend class CSharedPtr;
+
+	template <class T1>
+	friend class CLocalSharedPtr;
+
+	template <class T1>
+	friend class CEnableSharedPtr;
+
+	template <class T1>
+	friend class CAtomicSharedPtr;
+
+	template <class T1>
+	friend class CIntrusivePtr;
 };
 
 /* =====================================================================
@@ -566,6 +636,76 @@ inline CSharedPtr<T>::CSharedPtr(const CSharedToken<T> *token) :
 			   TYPE_NAME(T), this, token);
 }
 
+/* The base is at least pointer aligned,
+ * its low bit tells it from a CSharedToken<T>. */
+#define SPTR_BASE_TOKEN ((uintptr_t)1)
+
+template <class T>
+inline void *CSharedPtr<T>::ToBaseToken(void) const
+{
+	SHARED_PTR_CHECK();
+
+	if (nullptr == mBase) {
+		return nullptr;
+	}
+
+	if ((const void *)mPtr != mBase->mObj) {
+		return CSharedToken<T>::Create(*this);
+	}
+
+	mBase->AddRef();
+
+	return (void *)((uintptr_t)mBase | SPTR_BASE_TOKEN);
+}
+
+template <class T>
+inline CSharedPtr<T> CSharedPtr<T>::TakeToken(void *token)
+{
+	if (nullptr == token) {
+		return CSharedPtr<T>(nullptr);
+	}
+
+	if (0 == ((uintptr_t)token & SPTR_BASE_TOKEN)) {
+		CSharedToken<T> *sharedToken = (CSharedToken<T> *)token;
+		CSharedPtr<T> ret(sharedToken);
+
+		sharedToken->Release();
+		return ret;
+	}
+
+	CSharedBase<T> *base = (CSharedBase<T> *)((uintptr_t)token & ~SPTR_BASE_TOKEN);
+
+	return CSharedPtr<T>((T *)base->mObj, base);
+}
+
+template <class T>
+inline CSharedPtr<T> CSharedPtr<T>::BorrowToken(void *token)
+{
+	if (0 == ((uintptr_t)token & SPTR_BASE_TOKEN)) {
+		return CSharedPtr<T>((const CSharedToken<T> *)token);
+	}
+
+	CSharedBase<T> *base = (CSharedBase<T> *)((uintptr_t)token & ~SPTR_BASE_TOKEN);
+
+	return CSharedPtr<T>((T *)base->mObj, base->AddRef());
+}
+
+template <class T>
+inline void CSharedPtr<T>::ReleaseToken(void *token)
+{
+	if (nullptr == token) {
+		return;
+	}
+
+	if (0 == ((uintptr_t)token & SPTR_BASE_TOKEN)) {
+		((CSharedToken<T> *)token)->Release();
+	} else {
+		((CSharedBase<T> *)((uintptr_t)token & ~SPTR_BASE_TOKEN))->ReleaseRef();
+	}
+}
+
+#undef SPTR_BASE_TOKEN
+
 /* operator = nullptr */
 template <class T>
 inline CSharedPtr<T> &CSharedPtr<T>::operator = (std::nullptr_t)
@@ -1172,14 +1312,14 @@ template <class T>
 inline uint32_t CSharedPtr<T>::GetRef(void) const
 {
 	SHARED_PTR_CHECK();
-	return (nullptr == mBase) ? 0 : mBase->mRef;
+	return (nullptr == mBase) ? 0 : mBase->GetRef();
 }
 
 template <class T>
 inline uint32_t CSharedPtr<T>::GetWeakRef(void) const
 {
 	SHARED_PTR_CHECK();
-	return (nullptr == mBase) ? 0 : mBase->mWeakRef;
+	return (nullptr == mBase) ? 0 : mBase->GetWeakRef();
 }
 
 /* Convert */
@@ -1508,17 +1648,14 @@ inline CSharedPtr<T> CSharedPtr<T>::CopySharedPtr(const CSharedPtr<T1> &t1)
 	}
 }
 
-template <class T, class... Args>
-inline CSharedPtr<T> MakeShared(Args && ... args)
+/* Create T and its CSharedBase in one block of the pool, as laid out by Layout */
+template <class T, class Layout, class... Args>
+inline CSharedPtr<T> _MakeShared(Args && ... args)
 {
-	SPTR_DEBUG_ENTRY(SPTR_HEAD() " MakeShared. nParam: " SPTR_LONG,
-					 TYPE_NAME(T), sizeof...(args));
-	SPTR_VARIADIC_PRINT("\t" SPTR_TYPE() "\n", TYPE_NAME(decltype(args)));
-
 	typedef CSharedDefaultDeleter<T> CSharedDeleter;
+	typedef typename Layout::Backend Backend;
 
-	DEFINE_POOL_BASE(Pool, sizeof(CSharedBase<T>) + sizeof(T) + sizeof(CSharedDeleter),
-					 CSharedPtr<T>);
+	DEFINE_POOL_BASE_BACKEND(Pool, Layout::SIZE, CSharedPtr<T>, Backend);
 	char *buf = Pool::Alloc();
 
 	if (nullptr == buf) {
@@ -1527,20 +1664,13 @@ inline CSharedPtr<T> MakeShared(Args && ... args)
 	}
 
 	try {
-		char *tmp = buf + sizeof(CSharedBase<T>);
+		char *tmp = buf + Layout::OFFSET;
 		T *ptr = new (tmp) T(std::forward<decltype(args)>(args)...);
 
-		tmp += sizeof(T);
-		CSharedDeleter *deleter = new (tmp) CSharedDeleter(ptr);
-
 		CSharedBase<T> *base = new (buf) CSharedBase<T>(
-				Pool::Release, (void *)deleter, CSharedDeleter::Delete);
+				Pool::Release, (void *)ptr, CSharedDeleter::Delete);
 
-		CSharedPtr<T> ret(ptr, base);
-
-		SPTR_DEBUG_EXIT(SPTR_HEAD() " MakeShared. nParam: " SPTR_LONG,
-						TYPE_NAME(T), sizeof...(args));
-		return ret;
+		return CSharedPtr<T>(ptr, base);
 
 	} catch (const IException *e) {
 		Pool::Release(buf);
@@ -1549,8 +1679,76 @@ inline CSharedPtr<T> MakeShared(Args && ... args)
 	}
 }
 
+template <class T, class... Args>
+inline CSharedPtr<T> MakeShared(Args && ... args)
+{
+	SPTR_DEBUG_ENTRY(SPTR_HEAD() " MakeShared. nParam: " SPTR_LONG,
+					 TYPE_NAME(T), sizeof...(args));
+	SPTR_VARIADIC_PRINT("\t" SPTR_TYPE() "\n", TYPE_NAME(decltype(args)));
+
+	CArena *arena = is_arena_object<T>::value ? CArena::Current() : nullptr;
+
+	if (nullptr != arena) {
+		return MakeArenaShared<T>(*arena, std::forward<decltype(args)>(args)...);
+	}
+
+	CSharedPtr<T> ret(_MakeShared<T, CSharedLayout<T>>(std::forward<decltype(args)>(args)...));
+
+	SPTR_DEBUG_EXIT(SPTR_HEAD() " MakeShared. nParam: " SPTR_LONG,
+					TYPE_NAME(T), sizeof...(args));
+	return ret;
+}
+
+template <class T, class... Args>
+inline CSharedPtr<T> MakeIsolatedShared(Args && ... args)
+{
+	SPTR_DEBUG_ENTRY(SPTR_HEAD() " MakeIsolatedShared. nParam: " SPTR_LONG,
+					 TYPE_NAME(T), sizeof...(args));
+
+	CSharedPtr<T> ret(_MakeShared<T, CSharedLayout<T, true>>(std::forward<decltype(args)>(args)...));
+
+	SPTR_DEBUG_EXIT(SPTR_HEAD() " MakeIsolatedShared. nParam: " SPTR_LONG,
+					TYPE_NAME(T), sizeof...(args));
+	return ret;
+}
+
+/* The counters still work, but nothing is freed when they
+ * drop to 0. The memory is dropped by CArena::Reset(). */
+template <class T, class... Args>
+inline CSharedPtr<T> MakeArenaShared(CArena &arena, Args && ... args)
+{
+	SPTR_DEBUG_ENTRY(SPTR_HEAD() " MakeArenaShared. nParam: " SPTR_LONG,
+					 TYPE_NAME(T), sizeof...(args));
+
+	typedef CSharedLayout<T> Layout;
+
+	char *buf;
+
+	/* The arena only aligns to ARENA_ALIGN */
+	if (Layout::ALIGN > ARENA_ALIGN) {
+		buf = arena.Alloc(Layout::SIZE + Layout::ALIGN);
+		buf = (char *)(((uintptr_t)buf + Layout::ALIGN - 1) & ~(uintptr_t)(Layout::ALIGN - 1));
+	} else {
+		buf = arena.Alloc(Layout::SIZE);
+	}
+
+	T *ptr = new (buf + Layout::OFFSET) T(std::forward<decltype(args)>(args)...);
+
+	CSharedBase<T> *base = new (buf) CSharedBase<T>(
+			CArena::Release, nullptr, CArena::Destroy);
+
+	CSharedPtr<T> ret(ptr, base);
+
+	SPTR_DEBUG_EXIT(SPTR_HEAD() " MakeArenaShared. nParam: " SPTR_LONG,
+					TYPE_NAME(T), sizeof...(args));
+	return ret;
+}
+
 #include "SharedPtrOverload.hpp"
 #include "SharedToken.hpp"
+#include "LocalSharedPtr.hpp"
+#include "IntrusivePtr.hpp"
+#include "AtomicSharedPtr.hpp"
 
 #endif /* __SHARED_PTR_HPP__ */
 
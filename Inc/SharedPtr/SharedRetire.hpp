@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SHARED_RETIRE_HPP__
+#define __SHARED_RETIRE_HPP__
+
+#include <DataStruct/SList.hpp>
+#include <Common/Typedef.hpp>
+
+#define SHARED_RETIRE_BATCH 255
+
+/* Deferred destruction of the objects released by CSharedPtr.
+ *
+ * While a CSharedDeferScope is alive, the objects whose last
+ * reference is released by the calling thread are not destroyed
+ * at once but kept in a retire list of the thread. They are
+ * destroyed either by Drain() at a quiescent point of the same
+ * thread, or by Flush() giving them to a background thread which
+ * calls DrainShared(). What is left at thread exit is flushed.
+ *
+ * The objects are already unreachable when they are retired,
+ * so there is no epoch to wait for before destroying them. */
+class CSharedRetire
+{
+public:
+	typedef void (*ReclaimFn)(void *);
+
+	/* Called when the last reference is released.
+	 * Returns false if the calling thread does not defer. */
+	inline static bool Retire(void *base, ReclaimFn fn);
+
+	/* Destroy the objects retired by the calling thread */
+	inline static void Drain(void);
+
+	/* Give the objects retired by the calling thread to DrainShared() */
+	inline static void Flush(void);
+
+	/* Destroy the objects flushed by all the threads.
+	 * Only one thread may call it at a time. */
+	inline static void DrainShared(void);
+
+	/* Objects retired by the calling thread and not drained */
+	inline static uint32_t GetPending(void);
+
+private:
+	struct CRetireEntry
+	{
+		void *mBase;
+		ReclaimFn mFn;
+	};
+
+	struct CRetireBatch :
+		public SList
+	{
+		CRetireBatch *mPrev;
+		uint32_t mCount;
+		CRetireEntry mEntry[SHARED_RETIRE_BATCH];
+	};
+
+	struct CRetireLocal
+	{
+		CRetireBatch *mBatch;
+		CRetireBatch *mSpare;
+		uint32_t mPending;
+
+		inline ~CRetireLocal(void);
+	};
+
+	inline static void Reclaim(CRetireBatch *batch);
+
+	/* Kept apart from the list so the check costs a plain TLS read */
+	inline static uint32_t &GetDefer(void);
+	inline static CRetireLocal &GetLocal(void);
+	inline static SListHead *GetShared(void);
+
+	friend class CSharedDeferScope;
+};
+
+/* Defers the destruction on the calling thread until
+ * it goes out of scope. Scopes can be nested. */
+class CSharedDeferScope
+{
+public:
+	inline CSharedDeferScope(void)
+	{
+		++CSharedRetire::GetDefer();
+	}
+
+	inline ~CSharedDeferScope(void)
+	{
+		--CSharedRetire::GetDefer();
+	}
+};
+
+/* =====================================================================
+ *							Implement CSharedRetire
+ * ===================================================================== */
+inline bool CSharedRetire::Retire(void *base, ReclaimFn fn)
+{
+	if (0 == GetDefer()) {
+		return false;
+	}
+
+	CRetireLocal &local = GetLocal();
+	CRetireBatch *batch = local.mBatch;
+
+	if (nullptr == batch || SHARED_RETIRE_BATCH == batch->mCount) {
+		if (nullptr != local.mSpare) {
+			batch = local.mSpare;
+			local.mSpare = nullptr;
+		} else {
+			batch = new CRetireBatch;
+		}
+
+		batch->mPrev = local.mBatch;
+		batch->mCount = 0;
+		local.mBatch = batch;
+	}
+
+	batch->mEntry[batch->mCount].mBase = base;
+	batch->mEntry[batch->mCount].mFn = fn;
+	++batch->mCount;
+	++local.mPending;
+
+	return true;
+}
+
+/* The objects released by the destructors are destroyed at once */
+inline void CSharedRetire::Drain(void)
+{
+	CRetireLocal &local = GetLocal();
+	uint32_t defer = GetDefer();
+
+	GetDefer() = 0;
+
+	while (nullptr != local.mBatch) {
+		CRetireBatch *batch = local.mBatch;
+
+		local.mBatch = batch->mPrev;
+		Reclaim(batch);
+
+		if (nullptr == local.mSpare) {
+			local.mSpare = batch;
+		} else {
+			delete batch;
+		}
+	}
+
+	local.mPending = 0;
+	GetDefer() = defer;
+}
+
+inline void CSharedRetire::Flush(void)
+{
+	CRetireLocal &local = GetLocal();
+
+	/* The whole chain is given at once, linked by mPrev */
+	if (nullptr != local.mBatch) {
+		SList::Push(GetShared(), local.mBatch);
+		local.mBatch = nullptr;
+	}
+
+	local.mPending = 0;
+}
+
+inline void CSharedRetire::DrainShared(void)
+{
+	uint32_t defer = GetDefer();
+
+	GetDefer() = 0;
+
+	while (CRetireBatch *batch = (CRetireBatch *)SList::Pop(GetShared())) {
+		while (nullptr != batch) {
+			CRetireBatch *prev = batch->mPrev;
+
+			Reclaim(batch);
+			delete batch;
+			batch = prev;
+		}
+	}
+
+	GetDefer() = defer;
+}
+
+inline uint32_t CSharedRetire::GetPending(void)
+{
+	return GetLocal().mPending;
+}
+
+inline void CSharedRetire::Reclaim(CRetireBatch *batch)
+{
+	for (uint32_t i = 0; i < batch->mCount; ++i) {
+		batch->mEntry[i].mFn(batch->mEntry[i].mBase);
+	}
+}
+
+inline uint32_t &CSharedRetire::GetDefer(void)
+{
+	static thread_local uint32_t sDefer = 0;
+
+	return sDefer;
+}
+
+inline CSharedRetire::CRetireLocal &CSharedRetire::GetLocal(void)
+{
+	static thread_local CRetireLocal sLocal = {nullptr, nullptr, 0};
+
+	return sLocal;
+}
+
+inline SListHead *CSharedRetire::GetShared(void)
+{
+	static SListHead sShared;
+
+	return &sShared;
+}
+
+/* Not drained here: the deleters free through the thread_local
+ * pool magazines, which may be destroyed before this list. */
+inline CSharedRetire::CRetireLocal::~CRetireLocal(void)
+{
+	if (nullptr != mBatch) {
+		SList::Push(GetShared(), mBatch);
+	}
+
+	delete mSpare;
+}
+
+#endif /* __SHARED_RETIRE_HPP__ */
@@ -41,6 +41,10 @@ public:
 			 ENABLE_IF(MAYBE_ASSIGNABLE(T, T1))>
 	inline CWeakPtr(const CSharedPtr<T1> &t);
 
+	/* Copy and move constructor */
+	inline CWeakPtr(const CWeakPtr<T> &t);
+	inline CWeakPtr(CWeakPtr<T> &&t);
+
 	/* Destructor */
 	inline ~CWeakPtr(void);
 
@@ -49,6 +53,10 @@ public:
 			 ENABLE_IF(MAYBE_ASSIGNABLE(T, T1))>
 	inline CWeakPtr<T> &operator = (const CSharedPtr<T1> &t);
 
+	/* Copy and move */
+	inline CWeakPtr<T> &operator = (const CWeakPtr<T> &t);
+	inline CWeakPtr<T> &operator = (CWeakPtr<T> &&t);
+
 	/* Get shared pointer from weak pointer */
 	inline CSharedPtr<T> Lock(void) const;
 
@@ -107,6 +115,31 @@ inline CWeakPtr<T>::CWeakPtr(const CSharedPtr<T1> &t) :
 					TYPE_NAME(T), this, TYPE_NAME(T1), &t);
 }
 
+/* Copy constructor */
+template <class T>
+inline CWeakPtr<T>::CWeakPtr(const CWeakPtr<T> &t) :
+	mPtr(t.mPtr),
+	mBase((nullptr == t.mBase) ? nullptr : t.mBase->AddWeakRef())
+{
+	WEAK_PTR_CHECK();
+	SPTR_DEBUG(WPTR_HEAD() SPTR_PTR " Copy from " WPTR_HEAD() SPTR_PTR,
+			   TYPE_NAME(T), this, TYPE_NAME(T), &t);
+}
+
+/* Move constructor */
+template <class T>
+inline CWeakPtr<T>::CWeakPtr(CWeakPtr<T> &&t) :
+	mPtr(t.mPtr),
+	mBase(t.mBase)
+{
+	t.mPtr = nullptr;
+	t.mBase = nullptr;
+
+	WEAK_PTR_CHECK();
+	SPTR_DEBUG(WPTR_HEAD() SPTR_PTR " Move from " WPTR_HEAD() SPTR_PTR,
+			   TYPE_NAME(T), this, TYPE_NAME(T), &t);
+}
+
 /* Destructor */
 template <class T>
 inline CWeakPtr<T>::~CWeakPtr(void)
@@ -142,6 +175,36 @@ inline CWeakPtr<T> &CWeakPtr<T>::operator = (const CSharedPtr<T1> &t)
 	return *this;
 }
 
+/* Copy */
+template <class T>
+inline CWeakPtr<T> &CWeakPtr<T>::operator = (const CWeakPtr<T> &t)
+{
+	if (this != &t) {
+		CSharedBase<T> *base = (nullptr == t.mBase) ? nullptr : t.mBase->AddWeakRef();
+
+		Release();
+		mPtr = t.mPtr;
+		mBase = base;
+	}
+
+	return *this;
+}
+
+/* Move */
+template <class T>
+inline CWeakPtr<T> &CWeakPtr<T>::operator = (CWeakPtr<T> &&t)
+{
+	if (this != &t) {
+		Release();
+		mPtr = t.mPtr;
+		mBase = t.mBase;
+		t.mPtr = nullptr;
+		t.mBase = nullptr;
+	}
+
+	return *this;
+}
+
 /* Get shared pointer from weak pointer */
 template <class T>
 inline CSharedPtr<T> CWeakPtr<T>::Lock(void) const
@@ -185,14 +248,14 @@ template <class T>
 inline uint32_t CWeakPtr<T>::GetRef(void) const
 {
 	WEAK_PTR_CHECK();
-	return (nullptr == mBase) ? 0 : mBase->mRef;
+	return (nullptr == mBase) ? 0 : mBase->GetRef();
 }
 
 template <class T>
 inline uint32_t CWeakPtr<T>::GetWeakRef(void) const
 {
 	WEAK_PTR_CHECK();
-	return (nullptr == mBase) ? 0 : mBase->mWeakRef;
+	return (nullptr == mBase) ? 0 : mBase->GetWeakRef();
 }
 
 template <class T>
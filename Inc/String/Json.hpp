@@ -69,19 +69,22 @@ public:
 	inline CConstJsonPtr GetSibling(const Fn &fn) const;
 	inline CJsonPtr GetSibling(void) const;
 
-	inline decltype(auto) GetChildByKey(const CConstStringPtr &key);
+	/* The children are walked without holding them,
+	 * so fn must not remove any child: use the Iterator.
+	 * The key is borrowed, a literal allocates nothing. */
+	inline decltype(auto) GetChildByKey(const CStringRef &key);
 
 	template <class Fn>
-	inline CJsonPtr GetChildByKey(const CConstStringPtr &key, const Fn &fn);
+	inline CJsonPtr GetChildByKey(const CStringRef &key, const Fn &fn);
 	template <class Fn>
-	inline CConstJsonPtr GetChildByKey(const CConstStringPtr &key, const Fn &fn) const;
-	inline CJsonPtr GetChildByKey(const CConstStringPtr &key) const;
+	inline CConstJsonPtr GetChildByKey(const CStringRef &key, const Fn &fn) const;
+	inline CJsonPtr GetChildByKey(const CStringRef &key) const;
 
 	template <class Fn>
-	inline CJsonPtr GetChildByVal(const CConstStringPtr &val, const Fn &fn);
+	inline CJsonPtr GetChildByVal(const CStringRef &val, const Fn &fn);
 	template <class Fn>
-	inline CConstJsonPtr GetChildByVal(const CConstStringPtr &val, const Fn &fn) const;
-	inline CJsonPtr GetChildByVal(const CConstStringPtr &val) const;
+	inline CConstJsonPtr GetChildByVal(const CStringRef &val, const Fn &fn) const;
+	inline CJsonPtr GetChildByVal(const CStringRef &val) const;
 
 	template <class Fn>
     inline CJsonPtr GetType(const Fn &fn);
@@ -90,9 +93,12 @@ public:
 	inline CJson::Type GetType(void) const;
 
 	inline void SetKey(const CConstStringPtr &key);
+	inline void SetKey(CConstStringPtr &&key);
 	inline void SetVal(const CConstStringPtr &val);
+	inline void SetVal(CConstStringPtr &&val);
 
 	inline CJsonPtr AddChild(const CJsonPtr &child);
+	inline CJsonPtr AddChild(CJsonPtr &&child);
 	inline CJsonPtr AddChild(const CConstStringPtr &key = nullptr,
 							 const CConstStringPtr &val = nullptr,
 							 CJson::Type type = OBJECT);
@@ -154,24 +160,37 @@ public:
 
 	private:
 		CJsonPtr mParent;
-		CJsonPtr mPrev;
+		CIntrusivePtr<CJson> mPrev;
 		CJsonPtr mCurrent;
 	};
 
 	inline IteratorPtr GetChildren(void);
 
 	friend class CJson::Iterator;
+	friend class CStringToJson;
 private:
-	uint32_t GetSize(void) const;
-	void _ToString(CStringPtr &str) const;
+	/* A node holds its links with one pointer each */
+	typedef CIntrusivePtr<CJson> Link;
+
+	/* The siblings are walked in a loop, only the children recurse */
+	void _ToString(CStringBuilder &str) const;
+
+	/* Append json to the end of the list starting at head.
+	 * The list is walked without touching the reference counters. */
+	inline static void Append(Link &head, const CJsonPtr &json);
+	inline static void Append(Link &head, CJsonPtr &&json);
+	inline static Link &GetTail(Link &head);
+
+	/* Release a list without recursion */
+	static void Drop(Link &json);
 
 private:
 	CJson::Type mType;
 	CConstStringPtr mKey;
 	CConstStringPtr mVal;
 
-	CJsonPtr mChild;
-	CJsonPtr mSibling;
+	Link mChild;
+	Link mSibling;
 };
 
 template <class Fn>
@@ -266,11 +285,11 @@ inline CJsonPtr CJson::GetSibling(void) const
 	return mSibling;
 }
 
-inline decltype(auto) CJson::GetChildByKey(const CConstStringPtr &key)
+inline decltype(auto) CJson::GetChildByKey(const CStringRef &key)
 {
-	for (auto it(mChild); it; it = it->mSibling) {
-		if (it->mKey == key) {
-			return CJsonPromisePtr(it);
+	for (const Link *it = &mChild; *it; it = &(*it)->mSibling) {
+		if ((*it)->mKey == key) {
+			return CJsonPromisePtr(*it);
 		}
 	}
 
@@ -278,11 +297,11 @@ inline decltype(auto) CJson::GetChildByKey(const CConstStringPtr &key)
 }
 
 template <class Fn>
-inline CJsonPtr CJson::GetChildByKey(const CConstStringPtr &key, const Fn &fn)
+inline CJsonPtr CJson::GetChildByKey(const CStringRef &key, const Fn &fn)
 {
-	for (auto it(mChild); it; it = it->mSibling) {
-		if (it->mKey == key) {
-			fn(it);
+	for (const Link *it = &mChild; *it; it = &(*it)->mSibling) {
+		if ((*it)->mKey == key) {
+			fn(*it);
 		}
 	}
 
@@ -290,34 +309,34 @@ inline CJsonPtr CJson::GetChildByKey(const CConstStringPtr &key, const Fn &fn)
 }
 
 template <class Fn>
-inline CConstJsonPtr CJson::GetChildByKey(const CConstStringPtr &key, const Fn &fn) const
+inline CConstJsonPtr CJson::GetChildByKey(const CStringRef &key, const Fn &fn) const
 {
-	for (auto it(mChild); it; it = it->mSibling) {
-		if (it->mKey == key) {
-			fn(it);
+	for (const Link *it = &mChild; *it; it = &(*it)->mSibling) {
+		if ((*it)->mKey == key) {
+			fn(*it);
 		}
 	}
 
 	return Share();
 }
 
-inline CJsonPtr CJson::GetChildByKey(const CConstStringPtr &key) const
+inline CJsonPtr CJson::GetChildByKey(const CStringRef &key) const
 {
-	for (auto it(mChild); it; it = it->mSibling) {
-		if (it->mKey == key) {
-			return it;
+	for (const Link *it = &mChild; *it; it = &(*it)->mSibling) {
+		if ((*it)->mKey == key) {
+			return *it;
 		}
 	}
 
-	throw E("Cannot find child with key: ", key);
+	throw E("Cannot find child with key: ", key.ToString());
 }
 
 template <class Fn>
-inline CJsonPtr CJson::GetChildByVal(const CConstStringPtr &val, const Fn &fn)
+inline CJsonPtr CJson::GetChildByVal(const CStringRef &val, const Fn &fn)
 {
-	for (auto it(mChild); it; it = it->mSibling) {
-		if (it->mVal == val) {
-			fn(it);
+	for (const Link *it = &mChild; *it; it = &(*it)->mSibling) {
+		if ((*it)->mVal == val) {
+			fn(*it);
 		}
 	}
 
@@ -325,26 +344,26 @@ inline CJsonPtr CJson::GetChildByVal(const CConstStringPtr &val, const Fn &fn)
 }
 
 template <class Fn>
-inline CConstJsonPtr CJson::GetChildByVal(const CConstStringPtr &val, const Fn &fn) const
+inline CConstJsonPtr CJson::GetChildByVal(const CStringRef &val, const Fn &fn) const
 {
-	for (auto it(mChild); it; it = it->mSibling) {
-		if (it->mVal == val) {
-			fn(it);
+	for (const Link *it = &mChild; *it; it = &(*it)->mSibling) {
+		if ((*it)->mVal == val) {
+			fn(*it);
 		}
 	}
 
 	return Share();
 }
 
-inline CJsonPtr CJson::GetChildByVal(const CConstStringPtr &val) const
+inline CJsonPtr CJson::GetChildByVal(const CStringRef &val) const
 {
-	for (auto it(mChild); it; it = it->mSibling) {
-		if (it->mVal == val) {
-			return it;
+	for (const Link *it = &mChild; *it; it = &(*it)->mSibling) {
+		if ((*it)->mVal == val) {
+			return *it;
 		}
 	}
 
-	throw E("Cannot find child with val: ", val);
+	throw E("Cannot find child with val: ", val.ToString());
 }
 
 template <class Fn>
@@ -371,18 +390,31 @@ inline void CJson::SetKey(const CConstStringPtr &key)
 	mKey = key;
 }
 
+inline void CJson::SetKey(CConstStringPtr &&key)
+{
+	mKey = std::move(key);
+}
+
 inline void CJson::SetVal(const CConstStringPtr &val)
 {
 	mVal = val;
 }
 
+inline void CJson::SetVal(CConstStringPtr &&val)
+{
+	mVal = std::move(val);
+}
+
 inline CJsonPtr CJson::AddChild(const CJsonPtr &child)
 {
-	if (mChild) {
-		mChild->AddSibling(child);
-	} else {
-		mChild = child;
-	}
+	Append(mChild, child);
+
+	return Share();
+}
+
+inline CJsonPtr CJson::AddChild(CJsonPtr &&child)
+{
+	Append(mChild, std::move(child));
 
 	return Share();
 }
@@ -397,11 +429,7 @@ inline CJsonPtr CJson::AddChild(const CConstStringPtr &key,
 inline CJsonPtr CJson::AddChild(const CJsonPtr &child,
 								const CJson::JsonCbFn &cb)
 {
-	if (mChild) {
-		mChild->AddSibling(child);
-	} else {
-		mChild = child;
-	}
+	Append(mChild, child);
 
 	cb(child);
 
@@ -413,11 +441,7 @@ inline CJsonPtr CJson::AddSibling(Tn... tn, CJson::JsonCbFn &&cb)
 {
 	CJsonPtr sibling(tn...);
 
-	if (mSibling) {
-		mSibling->AddSibling(sibling);
-	} else {
-		mSibling = sibling;
-	}
+	Append(mSibling, sibling);
 
 	cb(mChild);
 
@@ -428,28 +452,39 @@ inline CJsonPtr CJson::AddSibling(const CConstStringPtr &key,
 								  const CConstStringPtr &val,
 								  CJson::Type type)
 {
-	CJsonPtr sibling(key, val, type);
-
-	if (mSibling) {
-		mSibling->AddSibling(sibling);
-	} else {
-		mSibling = sibling;
-	}
+	Append(mSibling, CJsonPtr(key, val, type));
 
 	return Share();
 }
 
 inline CJsonPtr CJson::AddSibling(const CJsonPtr &sibling)
 {
-	if (mSibling) {
-		mSibling->AddSibling(sibling);
-	} else {
-		mSibling = sibling;
-	}
+	Append(mSibling, sibling);
 
 	return Share();
 }
 
+inline CJson::Link &CJson::GetTail(Link &head)
+{
+	Link *tail = &head;
+
+	while (*tail) {
+		tail = &(*tail)->mSibling;
+	}
+
+	return *tail;
+}
+
+inline void CJson::Append(Link &head, const CJsonPtr &json)
+{
+	GetTail(head) = json;
+}
+
+inline void CJson::Append(Link &head, CJsonPtr &&json)
+{
+	GetTail(head) = std::move(json);
+}
+
 inline CJson::Iterator::Iterator(const CJsonPtr &parent) :
 	mParent(parent),
 	mPrev(nullptr),
@@ -472,8 +507,8 @@ inline bool CJson::Iterator::_End(void) const
 inline void CJson::Iterator::_Next(void)
 {
 	if (mCurrent) {
-		mPrev = mCurrent;
-		mCurrent = mCurrent->mSibling;
+		mPrev = std::move(mCurrent);
+		mCurrent = mPrev->mSibling;
 	}
 }
 
@@ -538,7 +573,7 @@ void CJson::Iterator::__Sort(const Fn &fn)
 			next->mSibling = head;
 			head = next;
 		} else {
-			CJsonPtr *it = &(head);
+			Link *it = &(head);
 
 			while (true) {
 				auto ikey(fn(*it));
@@ -570,11 +605,11 @@ void CJson::Iterator::__Sort(const Fn &fn)
 inline void CJson::Iterator::_Sort(CJson::Iterator::MatchType type)
 {
 	if (CJson::Iterator::KEY == type) {
-		__Sort([](const CJsonPtr &json) {
+		__Sort([](const Link &json) {
 			return json->mKey;
 		});
 	} else {
-		__Sort([](const CJsonPtr &json) {
+		__Sort([](const Link &json) {
 			return json->mVal;
 		});
 	}
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __NUMBER_HPP__
+#define __NUMBER_HPP__
+
+#include <type_traits>
+#include <limits>
+
+#include <Common/Typedef.hpp>
+#include <Meta/EnableIf.hpp>
+
+/* Enough for any integer or double, the \0 is not counted */
+#define NUMBER_MAX_SIZE 32
+
+/* Converts the numbers to and from the text, used by DEC(), HEX()
+ * and CString::ToNum().
+ *
+ * The integers are written two digits at a time from a table and
+ * read eight digits at a time (SWAR) on the little endian CPUs.
+ * The doubles are written with the shortest digits that read back
+ * to the same double (Grisu2), in the shorter of the fixed and the
+ * scientific form, like std::to_chars: 0.1, 123456, 1e+22, 5e-324.
+ *
+ * The To functions write to buf without \0 and return the size,
+ * buf must have NUMBER_MAX_SIZE bytes.
+ *
+ * The From functions read the number at the beginning of buf and
+ * return the chars used. They return 0 and keep val if there is no
+ * number or it does not fit in val (overflow). */
+class CNumber
+{
+public:
+	template <class T, ENABLE_IF(std::is_integral<T>)>
+	inline static uint32_t ToDec(char *buf, T val);
+	static uint32_t ToDec(char *buf, double val);
+
+	/* Upper case without 0x, a negative number gives its bits */
+	template <class T, ENABLE_IF(std::is_integral<T>)>
+	inline static uint32_t ToHex(char *buf, T val);
+
+	/* [-]digits, '-' only for the signed T */
+	template <class T, ENABLE_IF(std::is_integral<T>)>
+	inline static uint32_t FromDec(const char *buf, uint32_t size, T &val);
+
+	/* [-]digits[.digits][e[+-]digits] */
+	static uint32_t FromDec(const char *buf, uint32_t size, double &val);
+
+	/* Hex digits without 0x, read as the bits of T:
+	 * FFFFFFFF is -1 for int32_t. */
+	template <class T, ENABLE_IF(std::is_integral<T>)>
+	inline static uint32_t FromHex(const char *buf, uint32_t size, T &val);
+
+private:
+	static uint32_t FormatDec(char *buf, uint64_t val);
+	static uint32_t FormatHex(char *buf, uint64_t val);
+	static uint32_t ParseDec(const char *buf, uint32_t size, uint64_t &val);
+	static uint32_t ParseHex(const char *buf, uint32_t size, uint64_t &val);
+};
+
+/* =====================================================================
+ *							Implement CNumber
+ * ===================================================================== */
+template <class T, DECLARE_ENABLE_IF(std::is_integral<T>)>
+inline uint32_t CNumber::ToDec(char *buf, T val)
+{
+	if (val < 0) {
+		buf[0] = '-';
+
+		/* -val overflows for the min */
+		return 1 + FormatDec(buf + 1, 0 - (uint64_t)val);
+	}
+
+	return FormatDec(buf, (uint64_t)val);
+}
+
+template <class T, DECLARE_ENABLE_IF(std::is_integral<T>)>
+inline uint32_t CNumber::ToHex(char *buf, T val)
+{
+	return FormatHex(buf, (typename std::make_unsigned<T>::type)val);
+}
+
+template <class T, DECLARE_ENABLE_IF(std::is_integral<T>)>
+inline uint32_t CNumber::FromDec(const char *buf, uint32_t size, T &val)
+{
+	uint32_t neg = (std::is_signed<T>::value && size > 0 && '-' == buf[0]) ? 1 : 0;
+	uint64_t max = (uint64_t)std::numeric_limits<T>::max() + neg;
+	uint64_t ret;
+	uint32_t used = ParseDec(buf + neg, size - neg, ret);
+
+	if (0 == used || ret > max) {
+		return 0;
+	}
+
+	val = neg ? (T)(0 - ret) : (T)ret;
+
+	return used + neg;
+}
+
+template <class T, DECLARE_ENABLE_IF(std::is_integral<T>)>
+inline uint32_t CNumber::FromHex(const char *buf, uint32_t size, T &val)
+{
+	typedef typename std::make_unsigned<T>::type U;
+	uint64_t ret;
+	uint32_t used = ParseHex(buf, size, ret);
+
+	if (0 == used || ret > (uint64_t)std::numeric_limits<U>::max()) {
+		return 0;
+	}
+
+	val = (T)(U)ret;
+
+	return used;
+}
+
+#endif /* __NUMBER_HPP__ */
@@ -18,13 +18,14 @@
 #define __STRING_HPP__
 
 #include "StringHelp.hpp"
+#include "StringBuilder.hpp"
 #include "CommonString.hpp"
 #include "Json.hpp"
 
 #include <Regex/Regex.hpp>
 
 template <class... Tn,
-		 DECLARE_ENABLE_IF(has_constructor<CStringParam, Tn...>)>
+		 DECLARE_ENABLE_IF(is_string_param<Tn...>)>
 inline CString::CString(const Tn &... tn) :
 	mData(tn...)
 {
@@ -33,7 +34,7 @@ inline CString::CString(const Tn &... tn) :
 
 /* Create CString from other CString(s) */
 template <class... Tn,
-		 DECLARE_ENABLE_IF(!has_constructor<CStringParam, Tn...>),
+		 DECLARE_ENABLE_IF(!is_string_param<Tn...>),
 		 DECLARE_ENABLE_IFS(has_constructor<CConstStringPtr, Tn>)>
 inline CString::CString(const Tn &... tn) :
 	mData(CStringParam::CStringEmpty())
@@ -52,12 +53,7 @@ inline CString::CString(const Tn &... tn) :
 	}
 
 	/* Allocate the memory according to the total size */
-	if (size <= DEFAULT_STR_SIZE) {
-		mData = CStringParam();
-	} else {
-		CStringParam::CStringCapacity cap = {size};
-		mData = CStringParam(cap);
-	}
+	mData.Reserve(size);
 
 	/* Doing the copy */
 	for (uint32_t i = 0; i < sizeof...(tn); ++i) {
@@ -111,9 +107,10 @@ inline void CString::operator += (const CString &str)
 	mData.Append(str.mData);
 }
 
-inline bool CString::operator == (const CString &str) const
+inline bool CString::operator == (const CStringRef &str) const
 {
-	return mData == str.mData;
+	return (GetSize() == str.GetSize()) &&
+		(0 == ::memcmp(GetPtr(), str.GetPtr(), GetSize()));
 }
 
 inline char &CString::operator [] (uint32_t i)
@@ -196,25 +193,40 @@ inline int CString::Sprintf(const char *fmt, ...)
 	CHECK_PARAM(NULL != fmt, "NULL == fmt");
 
 	va_list ap;
+	int size;
 
 	va_start(ap, fmt);
-	SetSize(vsnprintf(GetPtr(), mData.GetCapacity(), fmt, ap));
+	size = vsnprintf(GetPtr(), mData.GetCapacity(), fmt, ap);
 	va_end(ap);
 
+	CHECK_PARAM(size >= 0, "Bad format: ", fmt);
+
+	/* Grows and prints again if it is truncated */
+	if ((uint32_t)size >= mData.GetCapacity()) {
+		mData.Reserve(size + 1);
+
+		va_start(ap, fmt);
+		vsnprintf(GetPtr(), mData.GetCapacity(), fmt, ap);
+		va_end(ap);
+	}
+
+	SetSize(size);
+
 	return GetSize();
 }
 
 inline void CString::Memset(uint32_t offset, uint32_t size, uint8_t val)
 {
-	CHECK_PARAM(GetCapacity() >= offset + size);
+	mData.Reserve(offset + size + 1);
 
 	::memset(GetPtr() + offset, val, size);
 	SetSize(size);
 }
 
+/* GetPtr() already adds the offset of str */
 inline void CString::Memcpy(const CString &str)
 {
-	Memcpy(str, str.GetOffset(), str.GetSize());
+	Memcpy(str, 0, str.GetSize());
 }
 
 inline void CString::Memcpy(const CString &str, uint32_t offset, uint32_t size)
@@ -225,6 +237,8 @@ inline void CString::Memcpy(const CString &str, uint32_t offset, uint32_t size)
 				". Offset: ", DEC(offset),
 				". String size: ", DEC(str.GetCapacity()));
 
+	mData.Reserve(size + 1);
+
 	::memcpy(GetPtr(), str.GetPtr() + offset, size);
 	SetSize(size);
 }
@@ -318,58 +332,20 @@ inline CStringPtr CString::Slice(int start, int end) const
 
 inline int CString::Find(char ch, Order order) const
 {
-	uint32_t size = GetSize();
-	const char *buf = GetPtr();
-
-	if (size < 1) {
-		return -1;
-	}
-
 	if (REVERSE == order) {
-		for (int i = (int)size - 1; i >= 0; --i) {
-			if (buf[i] == ch) {
-				return i;
-			}
-		}
-
+		return CStringSearch::FindCharRev(GetPtr(), GetSize(), ch);
 	} else {
-		for (uint32_t i = 0; i < size; ++i) {
-			if (buf[i] == ch) {
-				return (int)i;
-			}
-		}
+		return CStringSearch::FindChar(GetPtr(), GetSize(), ch);
 	}
-
-	return -1;
 }
 
-inline int CString::Find(const CConstStringPtr &str, Order order) const
+inline int CString::Find(const CStringRef &str, Order order) const
 {
-	uint32_t size = str->GetSize();
-	uint32_t _size = GetSize();
-	const char *buf = GetPtr();
-	const char *kbuf = str->GetPtr();
-
-	if (size > _size) {
-		return -1;
-	} else if (1 == size) {
-		return Find(kbuf[0], order);
+	if (REVERSE == order) {
+		return CStringSearch::FindRev(GetPtr(), GetSize(), str.GetPtr(), str.GetSize());
 	} else {
-		if (REVERSE == order) {
-			for (int i = (int)_size - (int)size; i >= 0; --i) {
-				if (0 == ::memcmp(&buf[i], kbuf, size))
-					return i;
-			}
-
-		} else {
-			for (uint32_t i = 0; i < _size - size; ++i) {
-				if (0 == ::memcmp(&buf[i], kbuf, size))
-					return (int)i;
-			}
-		}
+		return CStringSearch::Find(GetPtr(), GetSize(), str.GetPtr(), str.GetSize());
 	}
-
-	return -1;
 }
 
 inline int CString::FindToken(void) const
@@ -391,8 +367,8 @@ inline int CString::FindToken(void) const
 
 inline CString::CStringSwitchPtr CString::Switch(void) const
 {
-	return CStringSwitchPtr([&](const CConstStringPtr &str) {
-		return mData == str->mData;
+	return CStringSwitchPtr([&](const CStringRef &str) {
+		return *this == str;
 	});
 }
 
@@ -405,56 +381,60 @@ inline void CString::Match(const CStringPtr &regex, Fn) const
 //	engine.Match(Duplicate(), fn);
 }
 
-inline bool CString::ToNum(int &val) const
+template <class T, DECLARE_ENABLE_IF(std::is_integral<T>)>
+inline bool CString::ToNum(T &val) const
 {
 	const char *buf = GetPtr();
-	val = 0;
+	uint32_t size = GetSize();
 
 	/* Hex data */
-	if ((GetSize() > 2) && (buf[0] == '0') && (buf[1] == 'x')) {
-		for (uint32_t i = 2; i < GetSize(); ++i) {
-			if (buf[i] >= '0' && buf[i] <= '9') {
-				val = val * 16 + (buf[i] - '0');
-			} else if ((buf[i] >= 'A' || buf[i] <= 'F')) {
-				val = val * 16 + (buf[i] - 'A' + 10);
-			} else if ((buf[i] >= 'a' || buf[i] <= 'f')) {
-				val = val * 16 + (buf[i] - 'a' + 10);
-			} else {
-				return false;
-			}
-		}
+	if ((size > 2) && (buf[0] == '0') && (buf[1] == 'x')) {
+		return (size - 2) == CNumber::FromHex(buf + 2, size - 2, val);
+	}
+
 	/* Dec data */
-	} else {
-		int negative = 1;
-		uint32_t start = 0;
+	return (0 != size) && (size == CNumber::FromDec(buf, size, val));
+}
 
-		if (buf[0] == '-') {
-			negative = -1;
-			start = 1;
-		}
+inline bool CString::ToNum(double &val) const
+{
+	return (0 != GetSize()) &&
+		(GetSize() == CNumber::FromDec(GetPtr(), GetSize(), val));
+}
 
-		for (uint32_t i = start; i < GetSize(); ++i) {
-			if (buf[i] >= '0' || buf[i] <= '9') {
-				val = val * 10 + (buf[i] - '0');
-			} else {
-				return false;
-			}
-		}
+/* Like strtol(), but the buffer is not always NUL-terminated.
+ * Leading white space and one '+' or '-' are skipped the same way. */
+inline int CString::ToNum(NumberFormat format) const
+{
+	const char *buf = GetPtr();
+	uint32_t size = GetSize();
+	unsigned int val = 0;
+	bool neg = false;
 
-		val *= negative;
+	while ((size > 0) && (' ' == buf[0] || ('\t' <= buf[0] && buf[0] <= '\r'))) {
+		++buf;
+		--size;
 	}
 
-	return true;
-}
+	if ((size > 0) && ('+' == buf[0] || '-' == buf[0])) {
+		neg = ('-' == buf[0]);
+		++buf;
+		--size;
+	}
 
-inline int CString::ToNum(NumberFormat format) const
-{
-	static const int iformat[] = {
-		16,		/* HEX */
-		10		/* DEC */
-	};
+	if (FMT_HEX == format) {
+		if ((size > 2) && (buf[0] == '0') &&
+			(buf[1] == 'x' || buf[1] == 'X')) {
+			buf += 2;
+			size -= 2;
+		}
+
+		CNumber::FromHex(buf, size, val);
+	} else {
+		CNumber::FromDec(buf, size, val);
+	}
 
-	return ::strtol(GetPtr(), NULL, iformat[format]);
+	return neg ? (int)(0 - val) : (int)val;
 }
 
 inline bool CString::IsNum(void) const
@@ -487,6 +467,44 @@ inline bool CString::IsNum(void) const
 	return true;
 }
 
+/* =====================================================================
+ *							Implement CStringRef
+ * ===================================================================== */
+inline CStringRef::CStringRef(const CString &str) :
+	mBuf(str.GetPtr()),
+	mSize(str.GetSize()),
+	mStr(nullptr)
+{
+	/* Does nothing */
+}
+
+template <class T,
+		 DECLARE_ENABLE_IF(std::is_same<REMOVE_CONST(T), CString>)>
+inline CStringRef::CStringRef(const CSharedPtr<T> &str) :
+	mBuf(str ? ((const CString *)str.Get())->GetPtr() : nullptr),
+	mSize(str ? str->GetSize() : 0),
+	mStr(std::is_const<T>::value ? (const CConstStringPtr *)&str : nullptr)
+{
+	/* Does nothing */
+}
+
+inline CConstStringPtr CStringRef::ToString(void) const
+{
+	if (nullptr != mStr) {
+		return *mStr;
+	}
+
+	CStringPtr str(STR(mSize + 1));
+
+	char *buf = str->GetPtr();
+
+	::memcpy(buf, mBuf, mSize);
+	buf[mSize] = '\0';
+	str->SetSize(mSize);
+
+	return str;
+}
+
 inline CString::Iterator::Iterator(const CConstStringPtr &src) :
 	mSrc(src),
 	mStart(0),
@@ -514,5 +532,10 @@ inline void CString::Iterator::SetEnd(void)
 	mIsEnd = true;
 }
 
+inline const char *CString::Iterator::GetBuf(const CConstStringPtr &str)
+{
+	return str->GetPtr();
+}
+
 #endif /* __STRING_HPP__ */
 
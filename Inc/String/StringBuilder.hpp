@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __STRING_BUILDER_HPP__
+#define __STRING_BUILDER_HPP__
+
+#include <Os.hpp>
+#include <Pool/SizePool.hpp>
+
+#include "StringHelp.hpp"
+
+/* The first chunk, later ones grow with the size up to SIZE_POOL_MAX */
+#define STR_BUILDER_CHUNK 256
+
+/* Builds a string in a list of chunks.
+ *
+ * Nothing written is moved when it grows, so an append is O(1)
+ * and the size of the result is not needed up front. The chunks
+ * can be written out as they are with GetIovec(), or be copied
+ * into one CString by Flatten(). */
+class CStringBuilder
+{
+public:
+	inline CStringBuilder(void);
+	inline ~CStringBuilder(void);
+
+	inline void Append(const char *buf, uint32_t size);
+	inline void operator += (const CStringRef &str);
+	inline void operator += (char ch);
+
+	/* The next size bytes are appended without allocating */
+	inline void Reserve(uint32_t size);
+
+	inline uint32_t GetSize(void) const;
+
+	/* Fill iov with up to count chunks, return the number filled.
+	 * The buffers belong to the builder until it is changed. */
+	inline uint32_t GetIovec(struct iovec *iov, uint32_t count) const;
+	inline uint32_t GetChunkCount(void) const;
+
+	/* One CString with all the chunks, the builder is empty after.
+	 * A single chunk is handed over without copying. */
+	inline CStringPtr Flatten(void);
+
+	inline void Clear(void);
+
+private:
+	struct CChunk
+	{
+		CMemPtr mBuf;
+		char *mData;
+		CChunk *mNext;
+		uint32_t mSize;
+
+		/* A byte is kept after it for \0 */
+		uint32_t mCapacity;
+	};
+
+	inline void AppendSlow(const char *buf, uint32_t size);
+	inline void NewChunk(uint32_t size);
+
+private:
+	CChunk *mHead;
+	CChunk *mTail;
+	uint32_t mCount;
+	uint32_t mSize;
+
+	inline CStringBuilder(const CStringBuilder &);
+	inline CStringBuilder &operator = (const CStringBuilder &);
+};
+
+/* =====================================================================
+ *							Implement CStringBuilder
+ * ===================================================================== */
+inline CStringBuilder::CStringBuilder(void) :
+	mHead(nullptr),
+	mTail(nullptr),
+	mCount(0),
+	mSize(0)
+{
+	/* Does nothing */
+}
+
+inline CStringBuilder::~CStringBuilder(void)
+{
+	Clear();
+}
+
+inline void CStringBuilder::Append(const char *buf, uint32_t size)
+{
+	if (nullptr != mTail && size <= mTail->mCapacity - mTail->mSize) {
+		::memcpy(mTail->mData + mTail->mSize, buf, size);
+		mTail->mSize += size;
+		mSize += size;
+	} else {
+		AppendSlow(buf, size);
+	}
+}
+
+inline void CStringBuilder::operator += (const CStringRef &str)
+{
+	Append(str.GetPtr(), str.GetSize());
+}
+
+inline void CStringBuilder::operator += (char ch)
+{
+	Append(&ch, 1);
+}
+
+inline void CStringBuilder::Reserve(uint32_t size)
+{
+	if (nullptr == mTail || size > mTail->mCapacity - mTail->mSize) {
+		NewChunk(size);
+	}
+}
+
+inline uint32_t CStringBuilder::GetSize(void) const
+{
+	return mSize;
+}
+
+inline uint32_t CStringBuilder::GetIovec(struct iovec *iov, uint32_t count) const
+{
+	uint32_t i = 0;
+
+	for (CChunk *chunk = mHead; nullptr != chunk && i < count; chunk = chunk->mNext) {
+		if (0 != chunk->mSize) {
+			iov[i].iov_base = chunk->mData;
+			iov[i].iov_len = chunk->mSize;
+			++i;
+		}
+	}
+
+	return i;
+}
+
+inline uint32_t CStringBuilder::GetChunkCount(void) const
+{
+	return mCount;
+}
+
+inline CStringPtr CStringBuilder::Flatten(void)
+{
+	if (1 == mCount) {
+		mHead->mData[mHead->mSize] = '\0';
+
+		CStringPtr str(mHead->mBuf, mHead->mCapacity + 1);
+		str->SetSize(mHead->mSize);
+		Clear();
+
+		return str;
+	}
+
+	CStringPtr str(STR(mSize + 1));
+	char *buf = str->Convert<char *>();
+	uint32_t size = 0;
+
+	for (CChunk *chunk = mHead; nullptr != chunk; chunk = chunk->mNext) {
+		::memcpy(buf + size, chunk->mData, chunk->mSize);
+		size += chunk->mSize;
+	}
+
+	buf[size] = '\0';
+	str->SetSize(size);
+	Clear();
+
+	return str;
+}
+
+inline void CStringBuilder::Clear(void)
+{
+	while (nullptr != mHead) {
+		CChunk *next = mHead->mNext;
+
+		delete mHead;
+		mHead = next;
+	}
+
+	mTail = nullptr;
+	mCount = 0;
+	mSize = 0;
+}
+
+/* The tail is filled up first, the rest goes to a new chunk */
+inline void CStringBuilder::AppendSlow(const char *buf, uint32_t size)
+{
+	if (nullptr != mTail) {
+		uint32_t free = mTail->mCapacity - mTail->mSize;
+
+		::memcpy(mTail->mData + mTail->mSize, buf, free);
+		mTail->mSize += free;
+		mSize += free;
+		buf += free;
+		size -= free;
+	}
+
+	NewChunk(size);
+
+	::memcpy(mTail->mData, buf, size);
+	mTail->mSize = size;
+	mSize += size;
+}
+
+/* A chunk as big as all the others, so the count stays logarithmic
+ * until the chunks are SIZE_POOL_MAX, and they stay pooled. */
+inline void CStringBuilder::NewChunk(uint32_t size)
+{
+	uint32_t want = (mSize < STR_BUILDER_CHUNK) ? STR_BUILDER_CHUNK :
+		(mSize > SIZE_POOL_MAX) ? SIZE_POOL_MAX : mSize;
+	uint32_t cap;
+
+	/* Keeps a byte for \0 */
+	if (want < size + 1) {
+		want = size + 1;
+	}
+
+	CChunk *chunk = new CChunk;
+
+	chunk->mBuf = CSizePool::Alloc(want, cap);
+	chunk->mData = chunk->mBuf.Get();
+	chunk->mNext = nullptr;
+	chunk->mSize = 0;
+	chunk->mCapacity = cap - 1;
+
+	if (nullptr == mTail) {
+		mHead = chunk;
+	} else {
+		mTail->mNext = chunk;
+	}
+
+	mTail = chunk;
+	++mCount;
+}
+
+#endif /* __STRING_BUILDER_HPP__ */
@@ -22,11 +22,28 @@
 #include <DataStruct/List.hpp>
 #include <Meta/Is.hpp>
 #include "StringParam.hpp"
+#include "StringRef.hpp"
+#include "StringSearch.hpp"
 
 DEFINE_CLASS(Json);
 DEFINE_CLASS(String);
 DEFINE_CLASS(StringArray);
 
+/* A CStringPtr converts to const char * as well, so it could be
+ * taken as a buffer by CStringParam and measured by strlen(),
+ * which is wrong for a slice. It is copied as a CString instead. */
+template <class T>
+struct is_string_ptr :
+	std::integral_constant<bool,
+		std::is_same<T, CStringPtr>::value ||
+		std::is_same<T, CConstStringPtr>::value> {};
+
+template <class... Tn>
+struct is_string_param :
+	std::integral_constant<bool,
+		has_constructor<CStringParam, Tn...>::value &&
+		AllTrue(!is_string_ptr<Tn>::value...)> {};
+
 class CString
 {
 private:
@@ -41,12 +58,12 @@ public:
 
 public:
 	/* Create CString from parameters */
-	template <class... Tn, ENABLE_IF(has_constructor<CStringParam, Tn...>)>
+	template <class... Tn, ENABLE_IF(is_string_param<Tn...>)>
 	inline CString(const Tn &... tn);
 
 	/* Create CString from other CString(s) */
 	template <class... Tn,
-			 ENABLE_IF(!has_constructor<CStringParam, Tn...>),
+			 ENABLE_IF(!is_string_param<Tn...>),
 			 ENABLE_IFS(has_constructor<CConstStringPtr, Tn>)>
 	inline CString(const Tn &... tn);
 
@@ -60,7 +77,10 @@ public:
 
 	/* Overload operation */
 	inline void operator += (const CString &str);
-	inline bool operator == (const CString &str) const;
+
+	/* A CString, a CConstStringPtr or a literal is compared
+	 * through the CStringRef, so nothing is allocated. */
+	inline bool operator == (const CStringRef &str) const;
 	inline char &operator [] (uint32_t i);
 	inline const char &operator [] (uint32_t i) const;
 
@@ -101,14 +121,14 @@ public:
 	/* Find the given string
 	 * Return the index in the string */
 	inline int Find(char ch, Order order = NORMAL) const;
-	inline int Find(const CConstStringPtr &str, Order order = NORMAL) const;
+	inline int Find(const CStringRef &str, Order order = NORMAL) const;
 
 	/* Find the token. \bToken\b
 	 * Return the index in the string */
 	inline int FindToken(void) const;
 
 	/* Switch/Case */
-	DEFINE_SWITCHABLE(CString, CConstStringPtr);
+	DEFINE_SWITCHABLE(CString, CStringRef);
 	inline CStringSwitchPtr Switch(void) const;
 
 public:
@@ -141,10 +161,13 @@ public:
 
 	protected:
 		inline void SetEnd(void);
+
+		/* Raw buffer of a string, for the split iterators to search */
+		inline static const char *GetBuf(const CConstStringPtr &str);
 	};
 
 	/* Split string into string list */
-	IteratorPtr Split(const CConstStringPtr &str) const;
+	IteratorPtr Split(const CStringRef &str) const;
 	IteratorPtr SplitByToken(void) const;
 	IteratorPtr SplitByLine(void) const;
 
@@ -162,6 +185,8 @@ public:
 	template <class T>
 	friend class CException;
 
+	friend class CStringRef;
+
 private:
 	inline char *GetPtr(void);
 	inline const char *GetPtr(void) const;
@@ -173,7 +198,13 @@ public:
 		FMT_DEC,
 	};
 
-	inline bool ToNum(int &val) const;
+	/* Any integer or double, 0x for hex. False if it is
+	 * not a number or does not fit in val. */
+	template <class T, ENABLE_IF(std::is_integral<T>)>
+	inline bool ToNum(T &val) const;
+	inline bool ToNum(double &val) const;
+
+	/* 0 if it does not start with a number */
 	inline int ToNum(enum NumberFormat format = FMT_DEC) const;
 	inline bool IsNum(void) const;
 
@@ -29,12 +29,6 @@ const static uint8_t HexMap[] = {
 template <class T, ENABLE_IFEQ(sizeof(T), 1)>
 inline CStringPtr HEX(const T &t, uint32_t align = 0, char padding = ' ')
 {
-	CStringParam p(CStringParam::CT_BYTE, CStringParam::CM_HEX,
-				   (uint8_t)t, align, padding);
-
-	CString q(CStringParam::CT_BYTE, CStringParam::CM_HEX,
-				   (uint8_t)t, align, padding);
-
 	return CStringPtr(CStringParam::CT_BYTE, CStringParam::CM_HEX,
 					  (uint8_t)t, align, padding);
 }
@@ -88,6 +82,18 @@ inline CStringPtr DEC(T t, uint32_t align = 0, char padding = ' ')
 					  t, align, padding);
 }
 
+/* The shortest digits reading back to the same double */
+inline CStringPtr DEC(double t, uint32_t align = 0, char padding = ' ')
+{
+	return CStringPtr(CStringParam::CT_DWORD, CStringParam::CM_DEC,
+					  t, align, padding);
+}
+
+inline CStringPtr DEC(float t, uint32_t align = 0, char padding = ' ')
+{
+	return DEC((double)t, align, padding);
+}
+
 template <class T, ENABLE_IFEQ(sizeof(T), 1)>
 inline CStringPtr CHAR(T t, uint32_t align = 0, char padding = ' ')
 {
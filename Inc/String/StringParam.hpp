@@ -24,9 +24,11 @@
 #include <Function/Function.hpp>
 #include <Interface/Interface.hpp>
 #include <Meta/Meta.hpp>
-#include <Pool/MemPool.hpp>
+#include <Pool/SizePool.hpp>
 #include <Debug/Assert.hpp>
 
+#include "Number.hpp"
+
 //#define STR_DEBUG(fmt, ...) printf(fmt "\n", ##__VA_ARGS__)
 //#define STR_INFO(fmt, ...) printf(fmt "\n", ##__VA_ARGS__)
 
@@ -38,7 +40,8 @@
 #define STR_INFO(...)
 #endif
 
-#define DEFAULT_STR_SIZE 512
+/* A string shorter than this is kept in the param itself */
+#define STR_SMALL_SIZE 24
 
 class CString;
 
@@ -46,7 +49,7 @@ class CStringParam
 {
 public:
 	/* Default constructor.
-	 * The capacity is DEFAULT_STR_SIZE and the size is 0 */
+	 * The capacity is STR_SMALL_SIZE and the size is 0 */
 	inline CStringParam(void);
 
 	/* Constructor from the CMemPtr */
@@ -81,11 +84,14 @@ public:
 	};
 
 	enum Mode {
-		CM_DEC,		/* Convert to string with %d */
-		CM_HEX,		/* Convert to string with 0x%X */
+		CM_DEC,		/* Convert to decimal, see CNumber */
+		CM_HEX,		/* Convert to upper case hex without 0x */
 		CM_CHAR,	/* Convert to char */
 	};
 
+	/* Padded to align chars: padding '-' aligns to the left with
+	 * spaces, '0' puts the zeros after the sign, any other char
+	 * fills on the left. */
 	template <class T>
 	inline explicit CStringParam(Type type, Mode mode, T i,
 								 uint32_t align = 0, char padding = ' ');
@@ -109,14 +115,19 @@ public:
 
 	inline bool operator == (const CStringParam &str) const;
 
+	/* Grows the buffer if there is not enough space */
 	inline void Append(const CStringParam &param);
 
-	#define DEFAULT_STR_SIZE 512
-	typedef CMemPool<DEFAULT_STR_SIZE> StringBufPool;
-
 	inline void CheckAndAlloc(bool copy);
 
+	/* Make the buffer writable with at least size bytes */
+	inline void Reserve(uint32_t size);
+
 private:
+	/* Move to a new buffer of at least size bytes.
+	 * Up to STR_SMALL_SIZE it is the inline buffer. */
+	inline void Realloc(uint32_t size, bool copy);
+
 	inline char *_GetPtr(void);
 	inline const char *_GetPtr(void) const;
 
@@ -124,20 +135,24 @@ private:
 	uint32_t mCapacity;
 	uint32_t mSize;
 	uint32_t mOffset;
-	CMemPtr mBuf;
 	mutable atomic_t mNeedAlloc;
+
+	/* The string is in mSmall while mBuf is null */
+	char mSmall[STR_SMALL_SIZE];
+	CMemPtr mBuf;
 };
 
 #include "StringHelp.hpp"
 
 inline CStringParam::CStringParam(void) :
-	mCapacity(DEFAULT_STR_SIZE),
+	mCapacity(STR_SMALL_SIZE),
 	mSize(0),
 	mOffset(0),
-	mBuf(StringBufPool::Alloc()),
-	mNeedAlloc(0)
+	mNeedAlloc(0),
+	mBuf(nullptr)
 {
 	STR_DEBUG("Construct default");
+	mSmall[0] = '\0';
 }
 
 inline CStringParam::CStringParam(const CMemPtr &mem,
@@ -145,8 +160,8 @@ inline CStringParam::CStringParam(const CMemPtr &mem,
 	mCapacity(size),
 	mSize(size),
 	mOffset(offset),
-	mBuf(mem),
-	mNeedAlloc(0)
+	mNeedAlloc(0),
+	mBuf(mem)
 {
 	STR_DEBUG("Construct from CMemPtr, size: %u", size);
 }
@@ -156,27 +171,32 @@ inline CStringParam::CStringParam(const CStringParam &param,
 	mCapacity(param.GetCapacity()),
 	mSize(size),
 	mOffset(offset),
-	mBuf(param.mBuf),
-	mNeedAlloc(1)
+	mNeedAlloc(1),
+	mBuf(param.mBuf)
 {
 	STR_DEBUG("Construct from CStringParam, size: %u, offset: %u", size, offset);
-	param.mNeedAlloc = 1;
+
+	/* An inline string is copied, nothing is shared */
+	if (!mBuf) {
+		mCapacity = param.mCapacity;
+		::memcpy(mSmall, param.mSmall, STR_SMALL_SIZE);
+	} else {
+		param.mNeedAlloc = 1;
+	}
 }
 
 inline CStringParam::CStringParam(const CStringCapacity &capacity, uint32_t offset) :
-	mCapacity(capacity.cap),
+	mCapacity(STR_SMALL_SIZE),
 	mSize(0),
 	mOffset(offset),
-	mBuf(nullptr),
-	mNeedAlloc(0)
+	mNeedAlloc(0),
+	mBuf(nullptr)
 {
-	STR_DEBUG("Construct from capacity, capacity: %u, offset: %u", mCapacity, offset);
+	STR_DEBUG("Construct from capacity, capacity: %u, offset: %u", capacity.cap, offset);
 
-	if (mCapacity < DEFAULT_STR_SIZE) {
-		mBuf = StringBufPool::Alloc();
-		mCapacity = DEFAULT_STR_SIZE;
-	} else {
-		mBuf = CMemPtr(new char[mCapacity], CMemPtr::ArrayDeleter);
+	/* Keeps a byte for \0 */
+	if (capacity.cap >= STR_SMALL_SIZE) {
+		mBuf = CSizePool::Alloc(capacity.cap, mCapacity);
 	}
 }
 
@@ -184,8 +204,8 @@ inline CStringParam::CStringParam(const char *buf, uint32_t size) :
 	mCapacity(size),
 	mSize(size),
 	mOffset(0),
-	mBuf((char *)buf, mBuf.NullDeleter),
-	mNeedAlloc(1)
+	mNeedAlloc(1),
+	mBuf((char *)buf, mBuf.NullDeleter)
 {
 	CHECK_PARAM(NULL != buf, "buf is null");
 	STR_DEBUG("Construct from buf and size, buf: %p, size: %u", buf, size);
@@ -195,63 +215,79 @@ inline CStringParam::CStringParam(const char *buf) :
 	mCapacity(strlen(buf)),
 	mSize(strlen(buf)),
 	mOffset(0),
-	mBuf((char *)buf, mBuf.NullDeleter),
-	mNeedAlloc(1)
+	mNeedAlloc(1),
+	mBuf((char *)buf, mBuf.NullDeleter)
 {
 	CHECK_PARAM(NULL != buf, "buf is null");
 	STR_DEBUG("Construct from buf, buf: %p, size: %u", buf, mSize);
 }
 
+/* It is inline unless the number is padded to a larger align */
 template <class T>
 inline CStringParam::CStringParam(Type type, Mode mode, T i, uint32_t align, char padding) :
-	mCapacity(DEFAULT_STR_SIZE),
+	mCapacity(STR_SMALL_SIZE),
 	mSize(0),
 	mOffset(0),
-	mBuf(StringBufPool::Alloc()),
-	mNeedAlloc(0)
+	mNeedAlloc(0),
+	mBuf(nullptr)
 {
-	char fmt[32];
-	int size;
+	/* An enum is printed as its value */
+	typedef typename std::conditional<std::is_enum<T>::value, int64_t, T>::type N;
+	char num[NUMBER_MAX_SIZE];
+	uint32_t size;
 
 	STR_DEBUG("Construct from int or char, type: %u, mode: %u", type, mode);
-
-	if (' ' == padding) {
-		size = snprintf(fmt, 32, "%%%d", align);
-	} else {
-		size = snprintf(fmt, 32, "%%%c%d", padding, align);
-	}
-
-	if (CT_DWORD == type) {
-		fmt[size++] = 'l';
-		fmt[size++] = 'l';
-	}
+	(void)type;
 
 	switch (mode) {
 		case CM_DEC:
-			fmt[size++] = 'd';
+			size = CNumber::ToDec(num, (N)i);
 			break;
 
 		case CM_HEX:
-			fmt[size++] = 'X';
+			size = CNumber::ToHex(num, (uint64_t)i);
 			break;
 
-		case CM_CHAR:
-			fmt[size++] = 'c';
+		default:
+			num[0] = (char)i;
+			size = 1;
 			break;
 	}
 
-	fmt[size] = '\0';
-	mSize = snprintf(_GetPtr(), GetCapacity(), fmt, i);
+	uint32_t total = (size > align) ? size : align;
+	uint32_t pad = total - size;
+
+	if (total >= STR_SMALL_SIZE) {
+		mBuf = CSizePool::Alloc(total + 1, mCapacity);
+	}
+
+	char *buf = _GetPtr();
+
+	if ('-' == padding) {
+		::memcpy(buf, num, size);
+		::memset(buf + size, ' ', pad);
+	} else if ('0' == padding && CM_CHAR != mode && '-' == num[0]) {
+		buf[0] = '-';
+		::memset(buf + 1, '0', pad);
+		::memcpy(buf + 1 + pad, num + 1, size - 1);
+	} else {
+		::memset(buf, padding, pad);
+		::memcpy(buf + pad, num, size);
+	}
+
+	buf[total] = '\0';
+	mSize = total;
 }
 
 inline CStringParam::CStringParam(const CStringEmpty &) :
-	mCapacity(0),
+	mCapacity(STR_SMALL_SIZE),
 	mSize(0),
 	mOffset(0),
-	mBuf(nullptr),
-	mNeedAlloc(0)
+	mNeedAlloc(0),
+	mBuf(nullptr)
 {
 	STR_DEBUG("Construct empty");
+	mSmall[0] = '\0';
 }
 
 inline char *CStringParam::GetPtr(void)
@@ -268,17 +304,17 @@ inline const char *CStringParam::GetPtr(void) const
 
 inline char *CStringParam::_GetPtr(void)
 {
-	return mBuf.Get() + mOffset;
+	return (mBuf ? mBuf.Get() : mSmall) + mOffset;
 }
 
 inline const char *CStringParam::_GetPtr(void) const
 {
-	return mBuf.Get() + mOffset;
+	return (mBuf ? mBuf.Get() : mSmall) + mOffset;
 }
 
 inline uint32_t CStringParam::GetFree(void) const
 {
-	return mCapacity - mSize - 1;
+	return GetCapacity() - mSize - 1;
 }
 
 inline uint32_t CStringParam::GetSize(void) const
@@ -313,12 +349,12 @@ inline void CStringParam::SetOffset(uint32_t offset)
 
 inline int32_t CStringParam::Compare(const CStringParam &param) const
 {
-	const char *l = mBuf.Get();
-	const char *r = param.mBuf.Get();
+	const char *l = _GetPtr();
+	const char *r = param._GetPtr();
 	uint32_t size = GetSize();
 	uint32_t psize = param.GetSize();
-	uint32_t offset = GetOffset();
-	uint32_t poffset = param.GetOffset();
+	uint32_t offset = 0;
+	uint32_t poffset = 0;
 	int32_t ret = 0;
 
 	if (size < psize) {
@@ -350,14 +386,25 @@ inline bool CStringParam::operator == (const CStringParam &param) const
 
 inline void CStringParam::Append(const CStringParam &param)
 {
-	CheckAndAlloc(true);
-
-	uint32_t size = GetFree();
 	uint32_t nsize = param.GetSize();
-	size = size < nsize ? size : nsize;
 
-	::memcpy(&_GetPtr()[mSize], param._GetPtr(), size);
-	mSize += size;
+	/* Reserve a byte for \0 */
+	uint32_t size = mSize + nsize + 1;
+
+	/* Grow to at least twice of the size so that
+	 * appending in a loop is not quadratic.
+	 * The param may be a view of the old buffer,
+	 * so the old buffer is held until it is copied. */
+	if (ATOMIC_COMPARE_AND_SWAP(&mNeedAlloc, 1, 0) || size > GetCapacity()) {
+		CMemPtr old(mBuf);
+
+		Realloc(size > (mSize << 1) ? size : (mSize << 1), true);
+		::memcpy(&_GetPtr()[mSize], param._GetPtr(), nsize);
+	} else {
+		::memcpy(&_GetPtr()[mSize], param._GetPtr(), nsize);
+	}
+
+	mSize += nsize;
 
 	_GetPtr()[mSize] = '\0';
 }
@@ -368,16 +415,38 @@ inline void CStringParam::CheckAndAlloc(bool copy)
 		return;
 
 	/* Reserve a byte for \0 */
-	uint32_t size = GetSize() + 1;
-	CMemPtr buf(nullptr);
+	Realloc(GetSize() + 1, copy);
+}
 
-	if (size <= DEFAULT_STR_SIZE) {
-		buf = StringBufPool::Alloc();
-		mCapacity = DEFAULT_STR_SIZE;
-	} else {
-		buf = CMemPtr(new char[size], CMemPtr::ArrayDeleter);
-		mCapacity = size;
+inline void CStringParam::Reserve(uint32_t size)
+{
+	/* Reserve a byte for \0 */
+	if (size <= GetSize()) {
+		size = GetSize() + 1;
+	}
+
+	if (ATOMIC_COMPARE_AND_SWAP(&mNeedAlloc, 1, 0) || size > GetCapacity()) {
+		Realloc(size, true);
 	}
+}
+
+inline void CStringParam::Realloc(uint32_t size, bool copy)
+{
+	/* The string may already be in mSmall, so memmove */
+	if (size <= STR_SMALL_SIZE) {
+		if (copy) {
+			::memmove(mSmall, _GetPtr(), GetSize());
+			mSmall[GetSize()] = '\0';
+		}
+
+		mCapacity = STR_SMALL_SIZE;
+		mOffset = 0;
+		mBuf = nullptr;
+		return;
+	}
+
+	uint32_t cap;
+	CMemPtr buf(CSizePool::Alloc(size, cap));
 
 	if (copy) {
 		char *_buf = buf.Get();
@@ -385,6 +454,7 @@ inline void CStringParam::CheckAndAlloc(bool copy)
 		_buf[GetSize()] = '\0';
 	}
 
+	mCapacity = cap;
 	mOffset = 0;
 	mBuf = buf;
 }
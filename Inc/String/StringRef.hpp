@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __STRING_REF_HPP__
+#define __STRING_REF_HPP__
+
+#include <string.h>
+
+#include <Common/Common.hpp>
+#include <Interface/Interface.hpp>
+#include <Meta/Meta.hpp>
+#include <SharedPtr/SharedPtr.hpp>
+
+DEFINE_CLASS(String);
+
+/* Borrowed view of a string: a pointer and a size.
+ *
+ * Made from a literal, a buffer or a CString, nothing is allocated
+ * and no counter is touched. It does not hold the buffer, so it
+ * is only used for the parameters and must not be stored. */
+class CStringRef
+{
+public:
+	inline CStringRef(const char *buf);
+	inline CStringRef(const char *buf, uint32_t size);
+	inline CStringRef(const CString &str);
+
+	/* From CStringPtr and CConstStringPtr, nullptr is empty */
+	template <class T,
+			 ENABLE_IF(std::is_same<REMOVE_CONST(T), CString>)>
+	inline CStringRef(const CSharedPtr<T> &str);
+
+	inline const char *GetPtr(void) const;
+	inline uint32_t GetSize(void) const;
+
+	inline char operator [] (uint32_t i) const;
+	inline bool operator == (const CStringRef &ref) const;
+
+	/* A string holding the view: shares the buffer when made
+	 * from a CConstStringPtr, or copies it. */
+	inline CConstStringPtr ToString(void) const;
+
+private:
+	const char *mBuf;
+	uint32_t mSize;
+	const CConstStringPtr *mStr;
+};
+
+/* =====================================================================
+ *							Implement CStringRef
+ * ===================================================================== */
+inline CStringRef::CStringRef(const char *buf) :
+	mBuf(buf),
+	mSize((nullptr == buf) ? 0 : strlen(buf)),
+	mStr(nullptr)
+{
+	/* Does nothing */
+}
+
+inline CStringRef::CStringRef(const char *buf, uint32_t size) :
+	mBuf(buf),
+	mSize(size),
+	mStr(nullptr)
+{
+	/* Does nothing */
+}
+
+inline const char *CStringRef::GetPtr(void) const
+{
+	return mBuf;
+}
+
+inline uint32_t CStringRef::GetSize(void) const
+{
+	return mSize;
+}
+
+inline char CStringRef::operator [] (uint32_t i) const
+{
+	return mBuf[i];
+}
+
+inline bool CStringRef::operator == (const CStringRef &ref) const
+{
+	return (mSize == ref.mSize) && (0 == ::memcmp(mBuf, ref.mBuf, mSize));
+}
+
+#endif /* __STRING_REF_HPP__ */
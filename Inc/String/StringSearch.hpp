@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __STRING_SEARCH_HPP__
+#define __STRING_SEARCH_HPP__
+
+#include <Common/Typedef.hpp>
+
+/* Searches a char or a string in a buffer, used by CString::Find().
+ *
+ * The kernels are chosen at the first call by the CPU features:
+ * AVX2, SSE2 or the plain loops. The strings are searched by
+ * comparing their first and last chars to 16 or 32 positions at
+ * once, only the positions where both match are compared fully.
+ *
+ * All of them return the index of the first (or the last for Rev)
+ * match, -1 if nothing is found. The empty key matches at 0 (at
+ * size for Rev). */
+class CStringSearch
+{
+public:
+	enum Level {
+		SCALAR,
+		SSE2,
+		AVX2,
+	};
+
+	static int FindChar(const char *buf, uint32_t size, char ch);
+	static int FindCharRev(const char *buf, uint32_t size, char ch);
+
+	/* ksize must be at least 2 and at most size */
+	static int FindStr(const char *buf, uint32_t size,
+					   const char *key, uint32_t ksize);
+	static int FindStrRev(const char *buf, uint32_t size,
+						  const char *key, uint32_t ksize);
+
+	/* Any key size */
+	inline static int Find(const char *buf, uint32_t size,
+						   const char *key, uint32_t ksize);
+	inline static int FindRev(const char *buf, uint32_t size,
+							  const char *key, uint32_t ksize);
+
+	/* A char in set, set has 1 to 4 chars.
+	 * Used by the split iterators. */
+	static int FindAny(const char *buf, uint32_t size,
+					   const char *set, uint32_t nset);
+	static int FindAnyRev(const char *buf, uint32_t size,
+						  const char *set, uint32_t nset);
+
+	/* A char not in set */
+	static int SkipAny(const char *buf, uint32_t size,
+					   const char *set, uint32_t nset);
+	static int SkipAnyRev(const char *buf, uint32_t size,
+						  const char *set, uint32_t nset);
+
+	static Level GetLevel(void);
+
+	/* Use a lower level, for benchmark and debugging.
+	 * A level not supported by the CPU is lowered. */
+	static void SetLevel(Level level);
+};
+
+/* =====================================================================
+ *							Implement CStringSearch
+ * ===================================================================== */
+inline int CStringSearch::Find(const char *buf, uint32_t size,
+							   const char *key, uint32_t ksize)
+{
+	if (ksize > size) {
+		return -1;
+	} else if (0 == ksize) {
+		return 0;
+	} else if (1 == ksize) {
+		return FindChar(buf, size, key[0]);
+	} else {
+		return FindStr(buf, size, key, ksize);
+	}
+}
+
+inline int CStringSearch::FindRev(const char *buf, uint32_t size,
+								  const char *key, uint32_t ksize)
+{
+	if (ksize > size) {
+		return -1;
+	} else if (0 == ksize) {
+		return (int)size;
+	} else if (1 == ksize) {
+		return FindCharRev(buf, size, key[0]);
+	} else {
+		return FindStrRev(buf, size, key, ksize);
+	}
+}
+
+#endif /* __STRING_SEARCH_HPP__ */
@@ -0,0 +1,26 @@
+# Copyright (c) 2018 Guo Xiang
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+# One test program: Test/$(TEST).cpp linked with the EasyCpp library.
+# It is built and run by the $(TEST).Test rules of ../Makefile.
+
+PKG_NAME := $(TEST)
+PKG_PATH := EasyCpp
+I_AM_APP := 1
+SLIBS := EasyCpp
+
+SRC := \
+  Test/$(TEST).cpp \
+
+include $(TEMPLATE)
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <EasyCpp.hpp>
+#include "TestCommon.hpp"
+
+#define ROUNDS		20000
+
+static const char *sJson =
+	"{\"key\":\"val\",\"num\":123,\"obj\":{\"a\":\"b\",\"c\":[1,2,3,4,5,6]},"
+	"\"arr\":[\"x\",\"y\",\"z\"]}";
+
+static uint32_t sDestroyed = 0;
+
+struct CTestHandle
+{
+	~CTestHandle(void)
+	{
+		++sDestroyed;
+	}
+};
+
+/* Blocks allocated from all the pools and not released yet */
+static uint64_t GetLive(void)
+{
+	uint64_t live = 0;
+
+	CPoolTelemetry<>::ForEach([&live](const CPoolUsage &usage) {
+		live += usage.mLive;
+	});
+
+	return live;
+}
+
+int main(void)
+{
+	CArena arena;
+
+	{
+		CArenaScope scope(arena);
+
+		CStringPtr str(sJson);
+		CConstJsonPtr json = str->ToJson();
+
+		TEST_CHECK(json->GetChildByKey(CConstStringPtr("num"))->GetVal() ==
+				   CConstStringPtr("123"));
+
+		/* Not trivially destructible, so it is not in the arena */
+		MakeShared<CTestHandle>();
+		TEST_CHECK(1 == sDestroyed);
+		TEST_CHECK(0 == arena.GetUsed());
+
+		/* An arena buffer of a string is dropped by Reset() */
+		CStringPtr cat(sJson);
+
+		cat += CConstStringPtr(sJson);
+		TEST_CHECK(2 * strlen(sJson) == cat->GetSize());
+		TEST_CHECK(0 != arena.GetUsed());
+	}
+
+	arena.Reset();
+	TEST_CHECK(0 == arena.GetUsed());
+
+	/* The body of a request is made before the scope, the slices
+	 * of the parsed tree share its buffer and must release it. */
+	uint64_t live = GetLive();
+
+	for (uint32_t i = 0; i < 1000; ++i) {
+		CStringPtr body(sJson);
+
+		{
+			CArenaScope scope(arena);
+			CJsonPtr json = body->ToJson();
+		}
+
+		arena.Reset();
+	}
+
+	TEST_CHECK(live == GetLive());
+
+	uint64_t start = TestNow();
+
+	for (uint32_t i = 0; i < ROUNDS; ++i) {
+		CStringPtr str(sJson);
+		CJsonPtr json = str->ToJson();
+	}
+
+	uint64_t pool = TestNow();
+
+	for (uint32_t i = 0; i < ROUNDS; ++i) {
+		{
+			CArenaScope scope(arena);
+			CStringPtr str(sJson);
+			CJsonPtr json = str->ToJson();
+		}
+
+		arena.Reset();
+	}
+
+	uint64_t end = TestNow();
+
+	printf("Parse per request: pools %.2f us, arena %.2f us\n",
+		   (double)(pool - start) / ROUNDS / 1000,
+		   (double)(end - pool) / ROUNDS / 1000);
+
+	return 0;
+}
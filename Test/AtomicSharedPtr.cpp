@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <EasyCpp.hpp>
+#include <atomic>
+#include <mutex>
+#include "TestCommon.hpp"
+
+#define RUN_NS		500000000ULL
+#define WRITE_DELAY	2000
+
+static std::atomic<int64_t> sLive(0);
+
+struct CTestObj
+{
+	int64_t mVal;
+	int64_t mCheck;
+
+	CTestObj(int64_t val) :
+		mVal(val),
+		mCheck(~val)
+	{
+		++sLive;
+	}
+
+	~CTestObj(void)
+	{
+		mCheck = 0;
+		--sLive;
+	}
+};
+
+static volatile uint32_t sSink = 0;
+
+static void Delay(void)
+{
+	for (uint32_t i = 0; i < WRITE_DELAY; ++i) {
+		sSink = i;
+	}
+}
+
+/* Run readers until the writer has run for RUN_NS.
+ * Returns the loads done by all the readers. */
+template <class Read, class Write>
+static uint64_t Contend(uint32_t readers, const Read &read, const Write &write)
+{
+	std::atomic<bool> stop(false);
+	std::atomic<uint64_t> loads(0);
+	std::vector<std::thread> threads;
+
+	for (uint32_t i = 0; i < readers; ++i) {
+		threads.emplace_back([&]() {
+			uint64_t cnt = 0;
+
+			while (!stop.load(std::memory_order_relaxed)) {
+				read();
+				++cnt;
+			}
+
+			loads += cnt;
+		});
+	}
+
+	uint64_t start = TestNow();
+
+	for (uint64_t i = 0; TestNow() - start < RUN_NS; ++i) {
+		write(i);
+		Delay();
+	}
+
+	stop = true;
+
+	for (auto &thread : threads) {
+		thread.join();
+	}
+
+	return loads;
+}
+
+int main(void)
+{
+	uint32_t readers = TestThreads();
+
+	{
+		CAtomicSharedPtr<CTestObj> atomic(MakeShared<CTestObj>(0));
+
+		Contend(readers, [&atomic]() {
+			CSharedPtr<CTestObj> ptr = atomic.Load();
+
+			TEST_CHECK(ptr && ptr->mCheck == ~ptr->mVal);
+		}, [&atomic](uint64_t i) {
+			switch (i % 3) {
+			case 0:
+				atomic.Store(MakeShared<CTestObj>(i));
+				break;
+
+			case 1:
+				TEST_CHECK(atomic.Exchange(MakeShared<CTestObj>(i)));
+				break;
+
+			default: {
+				CSharedPtr<CTestObj> expected = atomic.Load();
+
+				TEST_CHECK(atomic.CompareExchange(expected, MakeShared<CTestObj>(i)));
+				break;
+			}
+			}
+		});
+
+		CSharedPtr<CTestObj> wrong = MakeShared<CTestObj>(-1);
+
+		TEST_CHECK(!atomic.CompareExchange(wrong, MakeShared<CTestObj>(-2)));
+		TEST_CHECK(wrong->mVal == atomic.Load()->mVal);
+	}
+
+	TEST_CHECK(0 == sLive.load());
+
+	/* A reader giving its count back may find the same base stored again */
+	{
+		CSharedPtr<CTestObj> objs[2] = {
+			MakeShared<CTestObj>(0), MakeShared<CTestObj>(1)
+		};
+
+		{
+			CAtomicSharedPtr<CTestObj> atomic(objs[0]);
+
+			Contend(readers, [&atomic, &objs]() {
+				CSharedPtr<CTestObj> ptr = atomic.Load();
+
+				TEST_CHECK(ptr == objs[0] || ptr == objs[1]);
+			}, [&atomic, &objs](uint64_t i) {
+				atomic.Store(objs[(i + 1) % 2]);
+			});
+		}
+
+		TEST_CHECK(1 == objs[0].GetRef() && 1 == objs[1].GetRef());
+	}
+
+	CAtomicSharedPtr<CTestObj> atomic(MakeShared<CTestObj>(0));
+	uint64_t lockFree = Contend(readers, [&atomic]() {
+		sSink = (uint32_t)atomic.Load()->mVal;
+	}, [&atomic](uint64_t i) {
+		atomic.Store(MakeShared<CTestObj>(i));
+	});
+
+	CSharedPtr<CTestObj> shared = MakeShared<CTestObj>(0);
+	std::mutex lock;
+	uint64_t locked = Contend(readers, [&shared, &lock]() {
+		CSharedPtr<CTestObj> ptr(nullptr);
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			ptr = shared;
+		}
+
+		sSink = (uint32_t)ptr->mVal;
+	}, [&shared, &lock](uint64_t i) {
+		CSharedPtr<CTestObj> ptr = MakeShared<CTestObj>(i);
+		std::lock_guard<std::mutex> guard(lock);
+
+		shared = ptr;
+	});
+
+	printf("%u readers: CAtomicSharedPtr %.1f M loads/s, mutex %.1f M loads/s\n",
+		   readers, lockFree * 1e9 / RUN_NS / 1e6, locked * 1e9 / RUN_NS / 1e6);
+
+	return 0;
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <EasyCpp.hpp>
+#include "TestCommon.hpp"
+
+#define TOKENS		3000000
+
+static int32_t sLive = 0;
+
+struct CTestA
+{
+	int64_t mA = 1;
+
+	virtual ~CTestA(void) {}
+};
+
+struct CTestB
+{
+	int64_t mB = 2;
+
+	virtual ~CTestB(void) {}
+};
+
+struct CTestDerived :
+	public CTestA,
+	public CTestB
+{
+	CTestDerived(void)
+	{
+		++sLive;
+	}
+
+	~CTestDerived(void)
+	{
+		--sLive;
+	}
+};
+
+struct CTestObj
+{
+	int64_t mVal = 7;
+
+	CTestObj(void)
+	{
+		++sLive;
+	}
+
+	~CTestObj(void)
+	{
+		--sLive;
+	}
+};
+
+/* Like a C library keeping the userdata of a callback */
+static void *volatile sUserData = nullptr;
+
+static __attribute__((noinline)) void *Pass(void *token)
+{
+	sUserData = token;
+	return sUserData;
+}
+
+int main(void)
+{
+	{
+		CSharedPtr<CTestObj> ptr = MakeShared<CTestObj>();
+		void *token = ptr.ToBaseToken();
+
+		TEST_CHECK(1 == ((uintptr_t)token & 1) && 2 == ptr.GetRef());
+
+		{
+			auto borrow = CSharedPtr<CTestObj>::BorrowToken(token);
+
+			TEST_CHECK(borrow.Get() == ptr.Get() && 3 == ptr.GetRef());
+		}
+
+		auto take = CSharedPtr<CTestObj>::TakeToken(token);
+
+		TEST_CHECK(take.Get() == ptr.Get() && 2 == ptr.GetRef());
+		take = nullptr;
+
+		CSharedPtr<CTestObj>::ReleaseToken(ptr.ToBaseToken());
+		TEST_CHECK(1 == ptr.GetRef());
+
+		TEST_CHECK(nullptr == CSharedPtr<CTestObj>(nullptr).ToBaseToken());
+		TEST_CHECK(!CSharedPtr<CTestObj>::TakeToken(nullptr));
+
+		/* The object is not at the start of the base */
+		CSharedPtr<CTestB> cast(MakeShared<CTestDerived>());
+		void *pooled = cast.ToBaseToken();
+
+		TEST_CHECK(0 == ((uintptr_t)pooled & 1));
+
+		{
+			auto borrow = CSharedPtr<CTestB>::BorrowToken(pooled);
+
+			TEST_CHECK(borrow.Get() == cast.Get() && 2 == borrow->mB);
+		}
+
+		auto back = CSharedPtr<CTestB>::TakeToken(pooled);
+
+		TEST_CHECK(back.Get() == cast.Get() && 2 == cast.GetRef());
+
+		uint64_t start = TestNow();
+
+		for (uint32_t i = 0; i < TOKENS; ++i) {
+			auto token = (CSharedToken<CTestObj> *)Pass(ptr.ToToken());
+			CSharedPtr<CTestObj> copy(token);
+
+			token->Release();
+		}
+
+		uint64_t toToken = TestNow();
+
+		for (uint32_t i = 0; i < TOKENS; ++i) {
+			auto copy = CSharedPtr<CTestObj>::TakeToken(Pass(ptr.ToBaseToken()));
+		}
+
+		uint64_t takeToken = TestNow();
+
+		token = ptr.ToBaseToken();
+
+		for (uint32_t i = 0; i < TOKENS; ++i) {
+			auto copy = CSharedPtr<CTestObj>::BorrowToken(Pass(token));
+		}
+
+		CSharedPtr<CTestObj>::ReleaseToken(token);
+
+		uint64_t borrowToken = TestNow();
+
+		TEST_CHECK(1 == ptr.GetRef());
+
+		printf("Per token: ToToken %.1f ns, TakeToken %.1f ns, BorrowToken %.1f ns\n",
+			   (double)(toToken - start) / TOKENS,
+			   (double)(takeToken - toToken) / TOKENS,
+			   (double)(borrowToken - takeToken) / TOKENS);
+	}
+
+	TEST_CHECK(0 == sLive);
+
+	return 0;
+}
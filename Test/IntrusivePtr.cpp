@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <EasyCpp.hpp>
+#include <atomic>
+#include "TestCommon.hpp"
+
+#define COPIES		20000000
+#define THREAD_COPIES	200000
+#define DEPTH		100000
+
+static std::atomic<uint32_t> sDestroyed(0);
+
+DEFINE_CLASS(TestNode);
+
+class CTestNode :
+	public CEnableSharedPtr<CTestNode>
+{
+public:
+	uint32_t mVal;
+
+	CTestNode(uint32_t val) :
+		mVal(val)
+	{
+		/* Does nothing */
+	}
+
+	~CTestNode(void)
+	{
+		++sDestroyed;
+	}
+};
+
+static volatile uint32_t sSink = 0;
+
+template <class Ptr>
+static double Churn(const Ptr &ptr)
+{
+	uint64_t start = TestNow();
+
+	for (uint32_t i = 0; i < COPIES; ++i) {
+		Ptr a(ptr);
+		Ptr b(a);
+
+		sSink = b->mVal;
+	}
+
+	return (double)(TestNow() - start) / COPIES;
+}
+
+static void TestCount(void)
+{
+	TEST_CHECK(sizeof(CIntrusivePtr<CTestNode>) == sizeof(void *));
+	TEST_CHECK(sizeof(CTestNodePtr) == 2 * sizeof(void *));
+
+	{
+		CIntrusivePtr<CTestNode> node = MakeIntrusive<CTestNode>(7);
+		CIntrusivePtr<CTestNode> copy(node);
+
+		TEST_CHECK(7 == node->mVal && 2 == node.GetRef() && copy == node);
+
+		CTestNodePtr shared = node;
+		CConstTestNodePtr constShared = copy;
+
+		TEST_CHECK(4 == node.GetRef() && shared.Get() == node.Get());
+		TEST_CHECK(5 == shared->Share().GetRef());
+
+		CIntrusivePtr<const CTestNode> constNode(std::move(constShared));
+
+		TEST_CHECK(!constShared && 4 == node.GetRef());
+
+		copy = nullptr;
+		shared = nullptr;
+		constNode = nullptr;
+		TEST_CHECK(1 == node.GetRef() && !copy);
+		TEST_CHECK(0 == sDestroyed);
+	}
+
+	TEST_CHECK(1 == sDestroyed);
+
+	/* The counters are atomic like the CSharedPtr ones */
+	CIntrusivePtr<CTestNode> node = MakeIntrusive<CTestNode>(1);
+
+	TestRun(TestThreads(), [&node](uint32_t) {
+		for (uint32_t i = 0; i < THREAD_COPIES; ++i) {
+			CIntrusivePtr<CTestNode> copy(node);
+			CTestNodePtr shared = copy;
+		}
+	});
+
+	TEST_CHECK(1 == node.GetRef());
+}
+
+static void TestJson(void)
+{
+	CJsonPtr json = CStringPtr("{\"c\":\"3\",\"a\":\"1\",\"b\":{\"d\":[1,2]}}")->ToJson();
+
+	CConstJsonPtr view = json;
+
+	CConstJsonPtr d = view->GetChildByKey("b");
+
+	d = d->GetChildByKey("d");
+	TEST_CHECK(d->GetChild()->GetVal() == "1");
+	TEST_CHECK(json->ToString() == "{\"c\":3,\"a\":1,\"b\":{\"d\":[1,2]}}");
+
+	json->GetChildren()->Sort();
+	TEST_CHECK(json->ToString() == "{\"a\":1,\"b\":{\"d\":[1,2]},\"c\":3}");
+
+	TEST_CHECK(json->GetChildren()->Erase(CConstStringPtr("b")));
+	json->AddChild(CConstStringPtr("e"), CConstStringPtr("x"));
+	TEST_CHECK(json->ToString() == "{\"a\":1,\"c\":3,\"e\":\"x\"}");
+
+	uint32_t cnt = 0;
+
+	json->GetChildren()->ForEach([&cnt](const CJsonPtr &child) {
+		TEST_CHECK(2 == child.GetRef());
+		++cnt;
+	});
+
+	TEST_CHECK(3 == cnt);
+
+	/* A child kept after its parent is dropped */
+	CJsonPtr child = view->GetChildByKey("c");
+
+	json = nullptr;
+	view = nullptr;
+	TEST_CHECK(1 == child.GetRef() && child->GetVal() == "3");
+
+	/* A deep tree is dropped without recursion */
+	CJsonPtr root(nullptr, nullptr);
+	CJsonPtr cur = root;
+
+	for (uint32_t i = 0; i < DEPTH; ++i) {
+		CJsonPtr next(nullptr, nullptr);
+
+		cur->AddChild(next);
+		cur = next;
+	}
+
+	cur = nullptr;
+	root = nullptr;
+}
+
+int main(void)
+{
+	TestCount();
+	TestJson();
+
+	double shared = Churn(MakeShared<CTestNode>(1));
+	double intrusive = Churn(MakeIntrusive<CTestNode>(1));
+
+	printf("2 copies + destroys: CSharedPtr %.2f ns, CIntrusivePtr %.2f ns\n",
+		   shared, intrusive);
+
+	return 0;
+}
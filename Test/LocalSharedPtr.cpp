@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <EasyCpp.hpp>
+#include "TestCommon.hpp"
+
+#define COPIES		20000000
+#define THREADS		4
+#define THREAD_COPIES	100000
+
+struct CTestObj
+{
+	uint32_t mVal;
+
+	CTestObj(uint32_t val) :
+		mVal(val)
+	{
+		/* Does nothing */
+	}
+};
+
+DEFINE_CLASS(TestNode);
+
+class CTestNode :
+	public CEnableSharedPtr<CTestNode>
+{
+};
+
+static volatile uint32_t sSink = 0;
+
+template <class Ptr>
+static double Churn(const Ptr &ptr)
+{
+	uint64_t start = TestNow();
+
+	for (uint32_t i = 0; i < COPIES; ++i) {
+		Ptr a(ptr);
+		Ptr b(a);
+
+		sSink = b->mVal;
+	}
+
+	return (double)(TestNow() - start) / COPIES;
+}
+
+int main(void)
+{
+	auto local = MakeLocalShared<CTestObj>(5);
+
+	TEST_CHECK(5 == local->mVal && local.IsLocal() && 1 == local.GetRef());
+
+	{
+		auto copy = local;
+
+		TEST_CHECK(2 == local.GetRef());
+	}
+
+	TEST_CHECK(1 == local.GetRef());
+
+	CSharedPtr<CTestObj> pub = local.Publish();
+
+	TEST_CHECK(!local.IsLocal() && 2 == pub.GetRef());
+
+	TestRun(THREADS, [&pub](uint32_t) {
+		for (uint32_t i = 0; i < THREAD_COPIES; ++i) {
+			CSharedPtr<CTestObj> copy(pub);
+		}
+	});
+
+	TEST_CHECK(2 == pub.GetRef());
+
+	auto node = MakeLocalShared<CTestNode>();
+
+	TEST_CHECK(node.IsLocal());
+
+	/* Share() publishes the base, the copies may go to other threads */
+	TestRun(THREADS, [shared = node->Share()](uint32_t) mutable {
+		for (uint32_t i = 0; i < THREAD_COPIES; ++i) {
+			CTestNodePtr copy(shared);
+		}
+
+		shared = nullptr;
+	});
+
+	TEST_CHECK(!node.IsLocal() && 1 == node.GetRef());
+
+	double atomic = Churn(MakeShared<CTestObj>(1));
+	double plain = Churn(MakeLocalShared<CTestObj>(1));
+
+	printf("2 copies + destroys: CSharedPtr %.2f ns, CLocalSharedPtr %.2f ns\n",
+		   atomic, plain);
+
+	return 0;
+}
@@ -0,0 +1,364 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <EasyCpp.hpp>
+#include <math.h>
+#include <random>
+#include <string>
+#include "TestCommon.hpp"
+
+#define FUZZ		100000
+#define VALUES		4096
+#define ROUNDS		200
+
+enum TestColor {
+	TEST_RED = -2,
+	TEST_BLUE = 7,
+};
+
+static std::string ToString(const CConstStringPtr &str)
+{
+	return std::string((const char *)str, str->GetSize());
+}
+
+/* Digits of the shortest %e which round trips */
+static int Shortest(double val)
+{
+	char buf[64];
+
+	for (int digits = 1; digits < 17; ++digits) {
+		snprintf(buf, sizeof(buf), "%.*e", digits - 1, val);
+
+		if (strtod(buf, nullptr) == val) {
+			return digits;
+		}
+	}
+
+	return 17;
+}
+
+/* Significant digits, without the trailing zeros */
+static int Significant(const char *buf, uint32_t size)
+{
+	int cnt = 0;
+	int zeros = 0;
+	bool started = false;
+
+	for (uint32_t i = 0; i < size && 'e' != buf[i]; ++i) {
+		if (buf[i] < '0' || buf[i] > '9') {
+			continue;
+		}
+
+		started = started || '0' != buf[i];
+
+		if (started) {
+			++cnt;
+			zeros = ('0' == buf[i]) ? zeros + 1 : 0;
+		}
+	}
+
+	return cnt - zeros;
+}
+
+static void CheckIntegers(std::mt19937_64 &rng)
+{
+	char buf[NUMBER_MAX_SIZE + 1];
+	char ref[64];
+
+	for (uint32_t i = 0; i < FUZZ; ++i) {
+		uint64_t u64 = rng() >> (rng() % 64);
+		int64_t s64 = (int64_t)u64 * ((rng() & 1) ? -1 : 1);
+		uint32_t size;
+
+		size = CNumber::ToDec(buf, u64);
+		buf[size] = '\0';
+		snprintf(ref, sizeof(ref), "%llu", (unsigned long long)u64);
+		TEST_CHECK(0 == strcmp(buf, ref));
+
+		size = CNumber::ToDec(buf, s64);
+		buf[size] = '\0';
+		snprintf(ref, sizeof(ref), "%lld", (long long)s64);
+		TEST_CHECK(0 == strcmp(buf, ref));
+
+		int64_t s64Back = 0;
+		int32_t s32 = 0;
+		bool fits = s64 >= INT32_MIN && s64 <= INT32_MAX;
+
+		TEST_CHECK(strlen(ref) == CNumber::FromDec(ref, strlen(ref), s64Back) && s64 == s64Back);
+		TEST_CHECK((0 != CNumber::FromDec(ref, strlen(ref), s32)) == fits);
+		TEST_CHECK(!fits || s32 == s64);
+
+		size = CNumber::ToHex(buf, u64);
+		buf[size] = '\0';
+		snprintf(ref, sizeof(ref), "%llX", (unsigned long long)u64);
+		TEST_CHECK(0 == strcmp(buf, ref));
+
+		uint64_t u64Back = 0;
+
+		TEST_CHECK(strlen(ref) == CNumber::FromHex(ref, strlen(ref), u64Back) && u64 == u64Back);
+
+		uint16_t u16 = 0;
+
+		snprintf(ref, sizeof(ref), "%llu", (unsigned long long)u64);
+		TEST_CHECK((0 != CNumber::FromDec(ref, strlen(ref), u16)) == (u64 <= UINT16_MAX));
+	}
+
+	uint64_t u64 = 0;
+	int64_t s64 = 0;
+	int32_t s32 = 0;
+	int8_t s8 = 0;
+	uint8_t u8 = 0;
+
+	TEST_CHECK(20 == CNumber::FromDec("18446744073709551615", 20, u64) && UINT64_MAX == u64);
+	TEST_CHECK(0 == CNumber::FromDec("18446744073709551616", 20, u64));
+	TEST_CHECK(0 == CNumber::FromDec("99999999999999999999", 20, u64));
+	TEST_CHECK(0 == CNumber::FromDec("123456789012345678901", 21, u64));
+	TEST_CHECK(25 == CNumber::FromDec("0000018446744073709551615", 25, u64) && UINT64_MAX == u64);
+	TEST_CHECK(20 == CNumber::FromDec("-9223372036854775808", 20, s64) && INT64_MIN == s64);
+	TEST_CHECK(0 == CNumber::FromDec("9223372036854775808", 19, s64));
+	TEST_CHECK(4 == CNumber::FromDec("-128", 4, s8) && -128 == s8);
+	TEST_CHECK(0 == CNumber::FromDec("128", 3, s8));
+	TEST_CHECK(0 == CNumber::FromDec("-1", 2, u8));
+	TEST_CHECK(0 == CNumber::FromDec("-", 1, s64));
+	TEST_CHECK(0 == CNumber::FromDec("", 0, s64));
+	TEST_CHECK(3 == CNumber::FromDec("12345678x", 3, s64) && 123 == s64);
+	TEST_CHECK(8 == CNumber::FromDec("12345678x", 9, s64) && 12345678 == s64);
+	TEST_CHECK(16 == CNumber::FromDec("1234567812345678abc", 19, s64) && 1234567812345678LL == s64);
+	TEST_CHECK(8 == CNumber::FromHex("FFFFFFFF", 8, s32) && -1 == s32);
+	TEST_CHECK(0 == CNumber::FromHex("1FFFFFFFF", 9, s32));
+	TEST_CHECK(3 == CNumber::FromHex("aBcg", 4, s32) && 0xabc == s32);
+}
+
+static void CheckDoubles(std::mt19937_64 &rng)
+{
+	char buf[NUMBER_MAX_SIZE + 1];
+	char ref[64];
+	uint32_t longer = 0;
+
+	for (uint32_t i = 0; i < FUZZ; ++i) {
+		uint64_t bits = rng();
+		double val;
+
+		/* Any bits, a decimal or a wide exponent */
+		if (0 == i % 3) {
+			memcpy(&val, &bits, sizeof(val));
+		} else if (1 == i % 3) {
+			val = (double)(int64_t)(bits >> (rng() % 64)) / pow(10.0, (int)(rng() % 30) - 10);
+		} else {
+			val = ldexp((double)(bits >> 11), (int)(rng() % 2100) - 1100);
+		}
+
+		if (!isfinite(val)) {
+			continue;
+		}
+
+		uint32_t size = CNumber::ToDec(buf, val);
+		buf[size] = '\0';
+
+		double back = strtod(buf, nullptr);
+
+		TEST_CHECK(size <= 25);
+		TEST_CHECK(back == val && signbit(back) == signbit(val));
+
+		if (0 != val && Significant(buf, size) > Shortest(val)) {
+			++longer;
+		}
+
+		double parsed = 0;
+
+		TEST_CHECK(size == CNumber::FromDec(buf, size, parsed) && parsed == val);
+
+		/* Any precision, most of them are not exact */
+		uint32_t refSize = snprintf(ref, sizeof(ref), "%.*g", (int)(rng() % 25) + 1, val);
+		double expected = strtod(ref, nullptr);
+
+		if (isfinite(expected)) {
+			TEST_CHECK(refSize == CNumber::FromDec(ref, refSize, parsed) && parsed == expected);
+		}
+
+		/* Close to the half way to the next double */
+		long double half = (long double)val + ((long double)nextafter(val, INFINITY) - val) / 2;
+
+		refSize = snprintf(ref, sizeof(ref), "%.*Le", (int)(rng() % 10) + 17, half);
+		expected = strtod(ref, nullptr);
+
+		if (isfinite(expected)) {
+			TEST_CHECK(refSize == CNumber::FromDec(ref, refSize, parsed) && parsed == expected);
+		}
+	}
+
+	/* Grisu2 may give one more digit than the shortest */
+	TEST_CHECK(longer < FUZZ / 100);
+
+	double val = 0;
+
+	TEST_CHECK(0 == CNumber::FromDec("1e400", 5, val));
+	TEST_CHECK(3 == CNumber::FromDec("1.5x", 4, val) && 1.5 == val);
+	TEST_CHECK(0 == CNumber::FromDec(".", 1, val));
+	TEST_CHECK(2 == CNumber::FromDec(".5", 2, val) && 0.5 == val);
+	TEST_CHECK(30 == CNumber::FromDec("123456789012345678901234567890", 30, val) &&
+			   123456789012345678901234567890.0 == val);
+	TEST_CHECK(8 == CNumber::FromDec("0.000001", 8, val) && 0.000001 == val);
+}
+
+static void CheckStrings(void)
+{
+	TEST_CHECK("12345" == ToString(DEC(12345)));
+	TEST_CHECK("4000000000" == ToString(DEC((uint32_t)4000000000U)));
+	TEST_CHECK("-00042" == ToString(DEC(-42, 6, '0')));
+	TEST_CHECK("   -42" == ToString(DEC(-42, 6)));
+	TEST_CHECK("42   " == ToString(DEC(42, 5, '-')));
+	TEST_CHECK(std::string(29, '0') + "7" == ToString(DEC(7, 30, '0')));
+	TEST_CHECK("0F" == ToString(HEX((uint8_t)0x0f, 2, '0')));
+	TEST_CHECK("FFFF" == ToString(HEX((int16_t)-1)));
+	TEST_CHECK("DEADBEEFCAFE" == ToString(HEX((uint64_t)0xDEADBEEFCAFEULL)));
+	TEST_CHECK("  x" == ToString(CHAR('x', 3)));
+	TEST_CHECK("0.1" == ToString(DEC(0.1)));
+	TEST_CHECK("-1.7976931348623157e+308" == ToString(DEC(-1.7976931348623157e308)));
+	TEST_CHECK("0.10000000149011612" == ToString(DEC(0.1f)));
+	TEST_CHECK("7" == ToString(DEC(TEST_BLUE)));
+	TEST_CHECK("-2" == ToString(DEC(TEST_RED)));
+
+	int32_t s32 = 0;
+	int64_t s64 = 0;
+	double val = 0;
+
+	TEST_CHECK(CStringPtr("123")->ToNum(s32) && 123 == s32);
+	TEST_CHECK(CStringPtr("-2147483648")->ToNum(s32) && INT32_MIN == s32);
+	TEST_CHECK(!CStringPtr("2147483648")->ToNum(s32));
+	TEST_CHECK(CStringPtr("2147483648")->ToNum(s64) && 2147483648LL == s64);
+	TEST_CHECK(CStringPtr("0xff")->ToNum(s32) && 255 == s32);
+	TEST_CHECK(!CStringPtr("0xfg")->ToNum(s32));
+	TEST_CHECK(!CStringPtr("12a")->ToNum(s32));
+	TEST_CHECK(!CStringPtr("")->ToNum(s32));
+	TEST_CHECK(CStringPtr("-1.25e3")->ToNum(val) && -1250 == val);
+	TEST_CHECK(123 == CStringPtr("123abc")->ToNum());
+	TEST_CHECK(42 == CStringPtr(" \t\n42")->ToNum());
+	TEST_CHECK(7 == CStringPtr("+7")->ToNum());
+	TEST_CHECK(-7 == CStringPtr(" -7")->ToNum());
+	TEST_CHECK(0 == CStringPtr("+-7")->ToNum());
+	TEST_CHECK(-31 == CStringPtr(" -0x1f")->ToNum(CString::FMT_HEX));
+	TEST_CHECK(INT32_MIN == CStringPtr("-2147483648")->ToNum());
+	TEST_CHECK(31 == CStringPtr("0x1F")->ToNum(CString::FMT_HEX));
+	TEST_CHECK(31 == CStringPtr("1F")->ToNum(CString::FMT_HEX));
+	TEST_CHECK(12 == CStringPtr("12345")->Slice(0, 2)->ToNum());
+}
+
+static volatile uint64_t sSink = 0;
+
+/* ns of fn(i) for each of the values */
+template <class Fn>
+static double Time(const Fn &fn)
+{
+	uint64_t start = TestNow();
+
+	for (uint32_t round = 0; round < ROUNDS; ++round) {
+		for (uint32_t i = 0; i < VALUES; ++i) {
+			sSink = sSink + (uint64_t)fn(i);
+		}
+	}
+
+	return (double)(TestNow() - start) / VALUES / ROUNDS;
+}
+
+static void Bench(std::mt19937_64 &rng)
+{
+	std::vector<int64_t> ints(VALUES);
+	std::vector<double> doubles(VALUES);
+	std::vector<std::string> intStrs(VALUES);
+	std::vector<std::string> doubleStrs(VALUES);
+	std::vector<std::string> shortStrs(VALUES);
+	std::vector<CStringPtr> numStrs;
+	char buf[64];
+
+	for (uint32_t i = 0; i < VALUES; ++i) {
+		uint64_t bits = rng();
+
+		ints[i] = (int64_t)(rng() >> (rng() % 60)) * ((rng() & 1) ? 1 : -1);
+		memcpy(&doubles[i], &bits, sizeof(double));
+		doubles[i] = isfinite(doubles[i]) ? doubles[i] : 1.5;
+
+		snprintf(buf, sizeof(buf), "%lld", (long long)ints[i]);
+		intStrs[i] = buf;
+		snprintf(buf, sizeof(buf), "%.17g", doubles[i]);
+		doubleStrs[i] = buf;
+		snprintf(buf, sizeof(buf), "%.3f", (double)(rng() % 1000000) / 1000);
+		shortStrs[i] = buf;
+		numStrs.push_back(CStringPtr(DEC((int32_t)ints[i])));
+	}
+
+	printf("DEC(int64_t)  %6.1f ns\n", Time([&ints](uint32_t i) {
+		return CStringPtr(DEC(ints[i]))->GetSize();
+	}));
+	printf("HEX(uint32_t) %6.1f ns\n", Time([&ints](uint32_t i) {
+		return CStringPtr(HEX((uint32_t)ints[i]))->GetSize();
+	}));
+	printf("ToNum(int &)  %6.1f ns\n", Time([&numStrs](uint32_t i) {
+		int32_t val = 0;
+
+		numStrs[i]->ToNum(val);
+		return val;
+	}));
+	printf("Format double: CNumber %6.1f ns, %%.17g %6.1f ns\n",
+		   Time([&doubles, &buf](uint32_t i) {
+				return CNumber::ToDec(buf, doubles[i]);
+		   }),
+		   Time([&doubles, &buf](uint32_t i) {
+				return snprintf(buf, sizeof(buf), "%.17g", doubles[i]);
+		   }));
+
+	auto parse = [](const std::vector<std::string> &strs) {
+		return [&strs](uint32_t i) {
+			double val = 0;
+
+			CNumber::FromDec(strs[i].c_str(), strs[i].size(), val);
+			return (uint64_t)val;
+		};
+	};
+
+	auto parseLibc = [](const std::vector<std::string> &strs) {
+		return [&strs](uint32_t i) {
+			return (uint64_t)strtod(strs[i].c_str(), nullptr);
+		};
+	};
+
+	printf("Parse double:  CNumber %6.1f ns, strtod %6.1f ns\n",
+		   Time(parse(doubleStrs)), Time(parseLibc(doubleStrs)));
+	printf("Parse %%.3f:    CNumber %6.1f ns, strtod %6.1f ns\n",
+		   Time(parse(shortStrs)), Time(parseLibc(shortStrs)));
+	printf("Parse int64_t: CNumber %6.1f ns, strtoll %6.1f ns\n",
+		   Time([&intStrs](uint32_t i) {
+				int64_t val = 0;
+
+				CNumber::FromDec(intStrs[i].c_str(), intStrs[i].size(), val);
+				return val;
+		   }),
+		   Time([&intStrs](uint32_t i) {
+				return strtoll(intStrs[i].c_str(), nullptr, 10);
+		   }));
+}
+
+int main(void)
+{
+	std::mt19937_64 rng(11);
+
+	CheckIntegers(rng);
+	CheckDoubles(rng);
+	CheckStrings();
+	Bench(rng);
+
+	return 0;
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <EasyCpp.hpp>
+#include "TestCommon.hpp"
+
+#define BLOCKS		64
+#define ROUNDS		20000
+
+struct CTestPool
+{
+	DEFINE_POOL_BASE(Pool, 64, CTestPool);
+};
+
+static double PoolRun(uint32_t threads)
+{
+	uint64_t start = TestNow();
+
+	TestRun(threads, [](uint32_t) {
+		char *blocks[BLOCKS];
+
+		for (uint32_t r = 0; r < ROUNDS; ++r) {
+			for (uint32_t i = 0; i < BLOCKS; ++i) {
+				blocks[i] = CTestPool::Pool::Alloc();
+				blocks[i][0] = (char)i;
+			}
+
+			for (uint32_t i = 0; i < BLOCKS; ++i) {
+				CTestPool::Pool::Release(blocks[i]);
+			}
+		}
+	});
+
+	return (double)(TestNow() - start) / ((uint64_t)threads * ROUNDS * BLOCKS);
+}
+
+static double SListRun(uint32_t threads)
+{
+	static SListHead head;
+	std::vector<SList> nodes(threads * BLOCKS);
+
+	for (auto &node : nodes) {
+		SList::Push(&head, &node);
+	}
+
+	uint64_t start = TestNow();
+
+	TestRun(threads, [](uint32_t) {
+		SList *blocks[BLOCKS];
+
+		for (uint32_t r = 0; r < ROUNDS; ++r) {
+			for (uint32_t i = 0; i < BLOCKS; ++i) {
+				blocks[i] = SList::Pop(&head);
+			}
+
+			for (uint32_t i = 0; i < BLOCKS; ++i) {
+				SList::Push(&head, blocks[i]);
+			}
+		}
+	});
+
+	double ns = (double)(TestNow() - start) / ((uint64_t)threads * ROUNDS * BLOCKS);
+
+	while (nullptr != SList::Pop(&head)) {
+		/* Empty it before the nodes go away */
+	}
+
+	return ns;
+}
+
+int main(void)
+{
+	printf("ns per Alloc + Release\n");
+	printf("threads  magazine  SList\n");
+
+	for (uint32_t threads = 1; threads <= TestThreads(); ++threads) {
+		double pool = PoolRun(threads);
+		double slist = SListRun(threads);
+
+		printf("%7u  %8.1f  %5.1f\n", threads, pool, slist);
+	}
+
+	return 0;
+}
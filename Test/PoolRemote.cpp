@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <EasyCpp.hpp>
+#include <mutex>
+#include "TestCommon.hpp"
+
+#define BLOCKS		4000000
+#define BATCH		256
+#define BLOCK_SIZE	120
+
+int main(void)
+{
+	std::mutex lock;
+	std::vector<std::vector<CMemPtr>> queue;
+	bool done = false;
+
+	uint64_t start = TestNow();
+
+	std::thread producer([&]() {
+		std::vector<CMemPtr> bufs;
+
+		for (uint32_t i = 0; i < BLOCKS; ++i) {
+			bufs.push_back(CMemPool<BLOCK_SIZE>::Alloc());
+			bufs.back().Get()[0] = (char)i;
+
+			if (BATCH == bufs.size()) {
+				std::lock_guard<std::mutex> guard(lock);
+
+				queue.push_back(std::move(bufs));
+				bufs.clear();
+			}
+		}
+
+		std::lock_guard<std::mutex> guard(lock);
+
+		done = true;
+	});
+
+	std::thread consumer([&]() {
+		while (true) {
+			std::vector<std::vector<CMemPtr>> work;
+			bool last;
+
+			{
+				std::lock_guard<std::mutex> guard(lock);
+
+				work.swap(queue);
+				last = done;
+			}
+
+			if (work.empty()) {
+				if (last) {
+					break;
+				}
+
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	producer.join();
+	consumer.join();
+
+	printf("Alloc on one thread, Release on another: %.1f ns per block\n",
+		   (double)(TestNow() - start) / BLOCKS);
+
+	CPoolTelemetry<>::ForEach([](const CPoolUsage &usage) {
+		if (usage.mBlockSize != CPoolPageBackend::BlockSize(BLOCK_SIZE)) {
+			return;
+		}
+
+		uint64_t blocks = (uint64_t)usage.mChunks *
+			(usage.mChunkSize / usage.mBlockSize);
+
+		printf("%u chunks mapped for %u blocks\n", usage.mChunks, BLOCKS);
+		TEST_CHECK(blocks < BLOCKS / 4);
+	});
+
+	return 0;
+}
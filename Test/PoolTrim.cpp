@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <EasyCpp.hpp>
+#include <String/Json.hpp>
+#include "TestCommon.hpp"
+
+#define BURST		500
+#define BLOCKS		200000
+
+/* Resident set size in KB */
+static long GetRss(void)
+{
+	FILE *file = fopen("/proc/self/statm", "r");
+	long size = 0;
+	long rss = 0;
+
+	TEST_CHECK(nullptr != file);
+	TEST_CHECK(2 == fscanf(file, "%ld %ld", &size, &rss));
+	fclose(file);
+
+	return rss * (OS_PAGE_SIZE / 1024);
+}
+
+static void Burst(void)
+{
+	std::vector<CMemPtr> bufs;
+
+	for (uint32_t i = 0; i < BURST; ++i) {
+		bufs.push_back(JsonBufPool::Alloc());
+		memset(bufs.back().Get(), 1, JSON_BUF_SIZE);
+	}
+}
+
+/* ns per Release while every 4th block stays, so no chunk can be trimmed */
+static double Release(uint32_t highWater)
+{
+	std::vector<char *> blocks(BLOCKS);
+
+	CMemPool<1000>::SetHighWater(highWater);
+	CMemPool<1000>::AllocBatch(blocks.data(), BLOCKS);
+
+	uint64_t start = TestNow();
+
+	for (uint32_t i = 0; i < BLOCKS; ++i) {
+		if (0 != i % 4) {
+			CMemPool<1000>::ReleaseBatch(&blocks[i], 1);
+		}
+	}
+
+	double ns = (double)(TestNow() - start) / (BLOCKS - BLOCKS / 4);
+
+	for (uint32_t i = 0; i < BLOCKS; i += 4) {
+		CMemPool<1000>::ReleaseBatch(&blocks[i], 1);
+	}
+
+	CMemPool<1000>::Flush();
+
+	return ns;
+}
+
+typedef CMemPool<4000, CPoolHugeBackend> HugePool;
+
+static CPoolUsage GetHugeUsage(void)
+{
+	CPoolUsage ret = {};
+
+	CPoolTelemetry<>::ForEach([&ret](const CPoolUsage &usage) {
+		if (CPoolHugeBackend::BlockSize(4000) == usage.mBlockSize &&
+			OS_HUGE_PAGE_SIZE <= usage.mChunkSize) {
+			ret = usage;
+		}
+	});
+
+	return ret;
+}
+
+/* The huge chunks are kept committed by Trim() and reused */
+static void TrimHuge(void)
+{
+	uint32_t cnt = 2 * OS_HUGE_PAGE_SIZE / CPoolHugeBackend::BlockSize(4000);
+	std::vector<char *> blocks(cnt);
+
+	HugePool::AllocBatch(blocks.data(), cnt);
+	HugePool::ReleaseBatch(blocks.data(), cnt);
+	HugePool::Trim();
+
+	CPoolUsage usage = GetHugeUsage();
+
+	TEST_CHECK(0 != usage.mChunks && usage.mChunks == usage.mIdleChunks);
+
+	HugePool::AllocBatch(blocks.data(), cnt);
+
+	for (auto block : blocks) {
+		memset(block, 1, 4000);
+	}
+
+	HugePool::ReleaseBatch(blocks.data(), cnt);
+	TEST_CHECK(usage.mChunks == GetHugeUsage().mChunks);
+}
+
+int main(void)
+{
+	long start = GetRss();
+
+	Burst();
+
+	long burst = GetRss();
+
+	JsonBufPool::Trim();
+
+	long trimmed = GetRss();
+
+	printf("RSS KB: start %ld, after the burst %ld, after Trim() %ld\n",
+		   start, burst, trimmed);
+	TEST_CHECK(burst - start > BURST * (JSON_BUF_SIZE / 1024) / 2);
+	TEST_CHECK(trimmed - start < (burst - start) / 10);
+
+	/* Same burst trimmed by the high water when it is flushed */
+	JsonBufPool::SetHighWater(16);
+	Burst();
+	JsonBufPool::Flush();
+
+	long highRss = GetRss();
+
+	printf("RSS KB: after a burst with SetHighWater(16) %ld\n", highRss);
+	TEST_CHECK(highRss - start < (burst - start) / 10);
+
+	TrimHuge();
+
+	double base = Release(0);
+	double high = Release(64);
+
+	printf("Release with partly used chunks: %.1f ns, with SetHighWater(64) %.1f ns\n",
+		   base, high);
+	TEST_CHECK(high < base * 2);
+
+	return 0;
+}
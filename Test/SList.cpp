@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <DataStruct/SList.hpp>
+#include "TestCommon.hpp"
+
+#define NODES		2000
+#define ROUNDS		20000
+
+/* Laid out as a SList, so a chain is linked by mNext as the
+ * pool links its blocks. */
+struct CTestNode
+{
+	CTestNode *mNext;
+	uint32_t mOwner;
+};
+
+static SListHead sHead;
+
+static void Take(CTestNode *node, uint32_t owner)
+{
+	TEST_CHECK(0 == node->mOwner);
+	node->mOwner = owner;
+}
+
+static void Round(uint32_t owner, uint32_t r)
+{
+	CTestNode *chain = nullptr;
+	CTestNode *last = nullptr;
+	uint32_t cnt = 0;
+
+	/* Now and then take the whole list */
+	if (0 == r % 1000) {
+		chain = (CTestNode *)SList::PopAll(&sHead);
+
+		for (CTestNode *node = chain; nullptr != node; node = node->mNext) {
+			Take(node, owner);
+			last = node;
+			++cnt;
+		}
+	} else {
+		for (uint32_t i = (r + owner) % 7 + 1; 0 != i; --i) {
+			CTestNode *node = (CTestNode *)SList::Pop(&sHead);
+
+			if (nullptr == node) {
+				break;
+			}
+
+			Take(node, owner);
+			node->mNext = chain;
+			chain = node;
+			last = (nullptr == last) ? node : last;
+			++cnt;
+		}
+	}
+
+	for (CTestNode *node = chain; nullptr != node; node = node->mNext) {
+		node->mOwner = 0;
+	}
+
+	if (0 == cnt) {
+		return;
+	}
+
+	/* Give them back one by one or as a chain */
+	if (0 == r % 2) {
+		SList::PushChain(&sHead, (SList *)chain, (SList *)last);
+	} else {
+		while (nullptr != chain) {
+			CTestNode *next = chain->mNext;
+
+			SList::Push(&sHead, (SList *)chain);
+			chain = next;
+		}
+	}
+}
+
+int main(void)
+{
+	uint32_t threads = TestThreads();
+	std::vector<CTestNode> nodes(NODES);
+
+	for (auto &node : nodes) {
+		node.mOwner = 0;
+		SList::Push(&sHead, (SList *)&node);
+	}
+
+	TestRun(threads, [](uint32_t idx) {
+		for (uint32_t r = 1; r <= ROUNDS; ++r) {
+			Round(idx + 1, r);
+		}
+	});
+
+	uint32_t cnt = 0;
+
+	for (CTestNode *node = (CTestNode *)SList::PopAll(&sHead);
+		 nullptr != node; node = node->mNext) {
+		Take(node, UINT32_MAX);
+		++cnt;
+	}
+
+	printf("%u threads, %u of %u nodes back, %u bytes head\n",
+		   threads, cnt, NODES, (uint32_t)sizeof(SListHead));
+	TEST_CHECK(NODES == cnt);
+
+	return 0;
+}
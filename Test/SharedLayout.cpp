@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <EasyCpp.hpp>
+#include <atomic>
+#include "TestCommon.hpp"
+
+#define OBJECTS		1000
+#define RUN_NS		500000000ULL
+#define MAKES		5000000
+
+struct alignas(32) CTestAlign32
+{
+	char mData[5];
+};
+
+struct alignas(128) CTestAlign128
+{
+	uint32_t mVal = 7;
+};
+
+struct CTestOdd
+{
+	char mData[3] = {1, 2, 3};
+};
+
+struct CTestHot
+{
+	volatile uint64_t mVal = 0;
+};
+
+template <class T>
+static void CheckAlign(uint32_t align, bool isolated)
+{
+	std::vector<CSharedPtr<T>> objs;
+
+	for (uint32_t i = 0; i < OBJECTS; ++i) {
+		objs.push_back(isolated ? MakeIsolatedShared<T>() : MakeShared<T>());
+		TEST_CHECK(0 == (uintptr_t)objs.back().Get() % align);
+	}
+
+	/* The counters of the neighbours are not overlapped */
+	for (auto &obj : objs) {
+		CSharedPtr<T> copy(obj);
+
+		TEST_CHECK(2 == obj.GetRef());
+	}
+}
+
+static void Contend(bool isolated, uint32_t readers)
+{
+	CSharedPtr<CTestHot> hot = isolated ?
+		MakeIsolatedShared<CTestHot>() : MakeShared<CTestHot>();
+	std::atomic<bool> stop(false);
+	std::atomic<uint64_t> copies(0);
+	std::vector<std::thread> threads;
+	uint64_t writes = 0;
+
+	for (uint32_t i = 0; i < readers; ++i) {
+		threads.emplace_back([&]() {
+			uint64_t cnt = 0;
+
+			while (!stop.load(std::memory_order_relaxed)) {
+				for (uint32_t j = 0; j < 1000; ++j) {
+					CSharedPtr<CTestHot> copy(hot);
+				}
+
+				cnt += 1000;
+			}
+
+			copies += cnt;
+		});
+	}
+
+	uint64_t start = TestNow();
+
+	while (TestNow() - start < RUN_NS) {
+		for (uint32_t i = 0; i < 100000; ++i) {
+			hot->mVal = hot->mVal + 1;
+		}
+
+		writes += 100000;
+	}
+
+	stop = true;
+
+	for (auto &thread : threads) {
+		thread.join();
+	}
+
+	double ns = (double)(TestNow() - start);
+
+	printf("%s: writer %.2f ns per write, readers %.2f ns per copy\n",
+		   isolated ? "isolated" : "packed  ", ns / writes,
+		   ns * readers / (copies ? copies.load() : 1));
+}
+
+int main(void)
+{
+	CheckAlign<CTestAlign32>(32, false);
+	CheckAlign<CTestAlign128>(128, false);
+	CheckAlign<CTestOdd>(1, false);
+	CheckAlign<CTestHot>(8, false);
+
+	CheckAlign<CTestAlign32>(64, true);
+	CheckAlign<CTestAlign128>(128, true);
+	CheckAlign<CTestOdd>(64, true);
+	CheckAlign<CTestHot>(64, true);
+
+	{
+		CArena arena;
+		CArenaScope scope(arena);
+
+		for (uint32_t i = 0; i < OBJECTS; ++i) {
+			auto align = MakeShared<CTestAlign128>();
+			auto odd = MakeShared<CTestOdd>();
+
+			TEST_CHECK(0 == (uintptr_t)align.Get() % 128 && 7 == align->mVal);
+			TEST_CHECK(3 == odd->mData[2]);
+		}
+	}
+
+	Contend(false, TestThreads() - 1);
+	Contend(true, TestThreads() - 1);
+
+	uint64_t start = TestNow();
+
+	for (uint32_t i = 0; i < MAKES; ++i) {
+		MakeShared<CTestHot>();
+	}
+
+	uint64_t packed = TestNow();
+
+	for (uint32_t i = 0; i < MAKES; ++i) {
+		MakeIsolatedShared<CTestHot>();
+	}
+
+	uint64_t end = TestNow();
+
+	printf("Make + release: packed %.1f ns, isolated %.1f ns, block %u vs %u bytes\n",
+		   (double)(packed - start) / MAKES, (double)(end - packed) / MAKES,
+		   CSharedLayout<CTestHot>::Backend::BlockSize(CSharedLayout<CTestHot>::SIZE),
+		   CSharedLayout<CTestHot, true>::Backend::BlockSize(CSharedLayout<CTestHot, true>::SIZE));
+
+	return 0;
+}
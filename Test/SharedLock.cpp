@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <EasyCpp.hpp>
+#include <atomic>
+#include "TestCommon.hpp"
+
+#define ROUNDS		5000
+#define LOCKERS		2
+#define LOCKS		1000
+#define MAGIC		0x5a5a5a5a5a5a5a5aULL
+
+static std::atomic<uint32_t> sDestroyed(0);
+
+struct CTestObj
+{
+	uint64_t mMagic;
+	uint64_t mData[4];
+
+	CTestObj(void) :
+		mMagic(MAGIC),
+		mData{1, 2, 3, 4}
+	{
+		/* Does nothing */
+	}
+
+	~CTestObj(void)
+	{
+		TEST_CHECK(MAGIC == mMagic);
+		mMagic = 0;
+		++sDestroyed;
+	}
+};
+
+int main(void)
+{
+	uint64_t locked = 0;
+
+	for (uint32_t r = 0; r < ROUNDS; ++r) {
+		CSharedPtr<CTestObj> ptr = MakeShared<CTestObj>();
+		CWeakPtr<CTestObj> weak(ptr);
+		std::atomic<uint32_t> ready(0);
+		std::atomic<uint64_t> ok(0);
+		std::vector<std::thread> threads;
+
+		/* Lock until the release below wins, or LOCKS times */
+		for (uint32_t t = 0; t < LOCKERS; ++t) {
+			threads.emplace_back([&]() {
+				CWeakPtr<CTestObj> mine(weak);
+
+				++ready;
+
+				for (uint32_t i = 0; i < LOCKS; ++i) {
+					CSharedPtr<CTestObj> obj = mine.Lock();
+
+					if (!obj) {
+						break;
+					}
+
+					TEST_CHECK(MAGIC == obj->mMagic && 4 == obj->mData[3]);
+					++ok;
+				}
+			});
+		}
+
+		while (ready.load() < (uint32_t)LOCKERS) {
+			std::this_thread::yield();
+		}
+
+		/* Vary where the release falls among the locks */
+		for (volatile uint32_t i = 0; i < (r % 64) * 100; ++i) {
+		}
+
+		ptr = nullptr;
+
+		for (auto &thread : threads) {
+			thread.join();
+		}
+
+		locked += ok;
+		TEST_CHECK(r + 1 == sDestroyed.load());
+	}
+
+	printf("%u rounds, %lu successful Lock()\n", ROUNDS, (unsigned long)locked);
+
+	return 0;
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <EasyCpp.hpp>
+#include <atomic>
+#include "TestCommon.hpp"
+
+#define OBJECTS		1000
+
+static std::atomic<uint32_t> sDestroyed(0);
+
+struct CTestObj
+{
+	char mData[100];
+
+	~CTestObj(void)
+	{
+		++sDestroyed;
+	}
+};
+
+int main(void)
+{
+	{
+		CSharedDeferScope scope;
+
+		for (uint32_t i = 0; i < OBJECTS; ++i) {
+			MakeShared<CTestObj>();
+		}
+
+		TEST_CHECK(OBJECTS == CSharedRetire::GetPending() && 0 == sDestroyed);
+		CSharedRetire::Drain();
+		TEST_CHECK(0 == CSharedRetire::GetPending() && OBJECTS == sDestroyed);
+	}
+
+	/* The objects left at thread exit are given to DrainShared() */
+	std::thread thread([]() {
+		CSharedDeferScope scope;
+
+		for (uint32_t i = 0; i < OBJECTS; ++i) {
+			MakeShared<CTestObj>();
+		}
+	});
+
+	thread.join();
+	TEST_CHECK(OBJECTS == sDestroyed);
+
+	CSharedRetire::DrainShared();
+	TEST_CHECK(2 * OBJECTS == sDestroyed);
+
+	return 0;
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <EasyCpp.hpp>
+#include <random>
+#include <string>
+#include "TestCommon.hpp"
+
+#define FUZZ		100000
+#define FUZZ_SIZE	200
+#define BIG_SIZE	(8 << 20)
+
+static int FindChar(const char *buf, uint32_t size, char ch)
+{
+	for (uint32_t i = 0; i < size; ++i) {
+		if (ch == buf[i]) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static int FindCharRev(const char *buf, uint32_t size, char ch)
+{
+	for (int i = (int)size - 1; i >= 0; --i) {
+		if (ch == buf[i]) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static int FindStr(const char *buf, uint32_t size, const char *key, uint32_t ksize)
+{
+	for (uint32_t i = 0; i + ksize <= size; ++i) {
+		if (0 == memcmp(buf + i, key, ksize)) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static int FindStrRev(const char *buf, uint32_t size, const char *key, uint32_t ksize)
+{
+	for (int i = (int)size - (int)ksize; i >= 0; --i) {
+		if (0 == memcmp(buf + i, key, ksize)) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static const char *sLevels[] = {"scalar", "sse2", "avx2"};
+static volatile int sSink = 0;
+
+/* GB/s of fn searching buf reps times */
+template <class Fn>
+static double Bandwidth(const std::string &buf, uint32_t reps, const Fn &fn)
+{
+	uint64_t start = TestNow();
+
+	for (uint32_t i = 0; i < reps; ++i) {
+		sSink = fn(buf.data(), (uint32_t)buf.size());
+	}
+
+	return (double)buf.size() * reps / (TestNow() - start);
+}
+
+static void Bench(const char *name, const std::string &buf,
+				  uint32_t reps, const char *key)
+{
+	uint32_t ksize = strlen(key);
+
+	printf("%-10s plain  char %6.2f GB/s  str %6.2f GB/s\n", name,
+		   Bandwidth(buf, reps, [](const char *buf, uint32_t size) {
+				return FindChar(buf, size, '#');
+		   }),
+		   Bandwidth(buf, reps, [key, ksize](const char *buf, uint32_t size) {
+				return FindStr(buf, size, key, ksize);
+		   }));
+
+	for (uint32_t level = CStringSearch::SCALAR; level <= CStringSearch::AVX2; ++level) {
+		CStringSearch::SetLevel((CStringSearch::Level)level);
+
+		if (level != CStringSearch::GetLevel()) {
+			continue;
+		}
+
+		printf("%-10s %-6s char %6.2f GB/s  rev %6.2f  str %6.2f GB/s  rev %6.2f\n",
+			   name, sLevels[level],
+			   Bandwidth(buf, reps, [](const char *buf, uint32_t size) {
+					return CStringSearch::FindChar(buf, size, '#');
+			   }),
+			   Bandwidth(buf, reps, [](const char *buf, uint32_t size) {
+					return CStringSearch::FindCharRev(buf, size, '#');
+			   }),
+			   Bandwidth(buf, reps, [key, ksize](const char *buf, uint32_t size) {
+					return CStringSearch::FindStr(buf, size, key, ksize);
+			   }),
+			   Bandwidth(buf, reps, [key, ksize](const char *buf, uint32_t size) {
+					return CStringSearch::FindStrRev(buf, size, key, ksize);
+			   }));
+	}
+}
+
+int main(void)
+{
+	std::mt19937 rng(1);
+
+	for (uint32_t level = CStringSearch::SCALAR; level <= CStringSearch::AVX2; ++level) {
+		CStringSearch::SetLevel((CStringSearch::Level)level);
+
+		/* Lowered on this CPU */
+		if (level != CStringSearch::GetLevel()) {
+			continue;
+		}
+
+		for (uint32_t i = 0; i < FUZZ; ++i) {
+			uint32_t size = rng() % FUZZ_SIZE;
+			uint32_t ksize = 2 + rng() % 6;
+			std::string buf(size, 'a');
+			std::string key(ksize, 'a');
+			char ch = 'a' + rng() % 4;
+
+			for (auto &c : buf) {
+				c = 'a' + rng() % 3;
+			}
+
+			for (auto &c : key) {
+				c = 'a' + rng() % 3;
+			}
+
+			const char *b = buf.data();
+
+			TEST_CHECK(FindChar(b, size, ch) == CStringSearch::FindChar(b, size, ch));
+			TEST_CHECK(FindCharRev(b, size, ch) == CStringSearch::FindCharRev(b, size, ch));
+
+			if (ksize <= size) {
+				TEST_CHECK(FindStr(b, size, key.data(), ksize) ==
+						   CStringSearch::FindStr(b, size, key.data(), ksize));
+				TEST_CHECK(FindStrRev(b, size, key.data(), ksize) ==
+						   CStringSearch::FindStrRev(b, size, key.data(), ksize));
+			}
+		}
+	}
+
+	CStringSearch::SetLevel(CStringSearch::AVX2);
+
+	CStringPtr str("hello world");
+
+	TEST_CHECK(9 == str->Find(CStringRef("ld")));
+	TEST_CHECK(6 == str->Find(CStringRef("world")));
+	TEST_CHECK(0 == str->Find(CStringRef("hello world")));
+	TEST_CHECK(2 == str->Find(CStringRef("ll"), CString::REVERSE));
+	TEST_CHECK(-1 == str->Find(CStringRef("xx")));
+	TEST_CHECK(10 == str->Find('d') && 7 == str->Find('o', CString::REVERSE));
+
+	std::string line = "2024-05-01T12:00:00.123Z INFO [worker-7] request id=8d3f0a "
+		"handled in 12ms status=200 path=/api/v1/items?limit=50 user=alice";
+	std::string big(BIG_SIZE, 'x');
+
+	for (auto &c : big) {
+		c = "abcdefghij klmnop\n"[rng() % 18];
+	}
+
+	Bench("log line", line, 1000000, "user=alice");
+	Bench("8 MB", big, 20, "zzqq");
+
+	return 0;
+}
@@ -0,0 +1,360 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <EasyCpp.hpp>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include "TestCommon.hpp"
+
+#define FUZZ		20000
+#define SPLITS		2000
+#define BENCH_SIZE	(8 << 20)
+#define BENCH_RUNS	5
+
+static bool InSet(char ch, const char *set, uint32_t nset)
+{
+	return nullptr != memchr(set, ch, nset);
+}
+
+static int FindAny(const char *buf, uint32_t size,
+				   const char *set, uint32_t nset, bool in, bool rev)
+{
+	for (uint32_t i = 0; i < size; ++i) {
+		uint32_t idx = rev ? size - 1 - i : i;
+
+		if (in == InSet(buf[idx], set, nset)) {
+			return idx;
+		}
+	}
+
+	return -1;
+}
+
+static std::string ToString(const CConstStringPtr &str)
+{
+	return str->GetSize() ? std::string(&(*str)[0], str->GetSize()) : std::string();
+}
+
+/* The pieces of the old per-character split loops */
+static std::vector<std::string> RefSplit(const std::string &str, const std::string &key)
+{
+	std::vector<std::string> out;
+	size_t start = 0;
+
+	if (str.size() < key.size()) {
+		return out;
+	}
+
+	while (true) {
+		size_t pos = str.find(key, start);
+
+		if (std::string::npos == pos) {
+			out.push_back(str.substr(start));
+			return out;
+		}
+
+		out.push_back(str.substr(start, pos - start));
+		start = pos + key.size();
+	}
+}
+
+static std::vector<std::string> RefToken(const std::string &str)
+{
+	std::vector<std::string> out;
+	size_t i = 0;
+
+	while (i < str.size()) {
+		while (i < str.size() && InSet(str[i], " \t\r\n", 4)) {
+			++i;
+		}
+
+		size_t start = i;
+
+		while (i < str.size() && !InSet(str[i], " \t\r\n", 4)) {
+			++i;
+		}
+
+		if (start < i) {
+			out.push_back(str.substr(start, i - start));
+		}
+	}
+
+	return out;
+}
+
+/* \n, \n\r and \r\n end a line, a single \r does not */
+static std::vector<std::string> RefLine(const std::string &str)
+{
+	std::vector<std::string> out;
+	size_t size = str.size();
+	size_t start = 0;
+
+	if (0 == size) {
+		return out;
+	}
+
+	for (size_t i = 0; i < size; ++i) {
+		bool next = (i + 1 < size);
+		size_t step;
+
+		if ('\n' == str[i]) {
+			step = (next && '\r' == str[i + 1]) ? 2 : 1;
+		} else if ('\r' == str[i] && next && '\n' == str[i + 1]) {
+			step = 2;
+		} else {
+			continue;
+		}
+
+		out.push_back(str.substr(start, i - start));
+		start = i + step;
+		i = start - 1;
+
+		/* The string ends with a new line */
+		if (start >= size) {
+			out.push_back(std::string());
+			return out;
+		}
+	}
+
+	out.push_back(str.substr(start));
+	return out;
+}
+
+static std::vector<std::string> Pieces(const CString::IteratorPtr &it)
+{
+	std::vector<std::string> out;
+
+	it->ForEach([&out](const CConstStringPtr &str) {
+		out.push_back(ToString(str));
+	});
+
+	return out;
+}
+
+static std::vector<std::string> Reversed(std::vector<std::string> pieces)
+{
+	std::reverse(pieces.begin(), pieces.end());
+	return pieces;
+}
+
+/* The pieces of all the ways to walk the iterators made by mk */
+template <class Mk>
+static void Walk(std::string &out, const Mk &mk)
+{
+	auto add = [&out](const CConstStringPtr &str) {
+		out += "[" + ToString(str) + "]";
+	};
+
+	mk()->ForEach(add);
+	out += "|";
+	mk()->Reverse()->ForEach(add);
+	out += "|";
+
+	for (uint32_t steps = 1; steps <= 3; ++steps) {
+		for (bool reverse : {false, true}) {
+			auto it = reverse ? mk()->Reverse() : mk();
+
+			it->First(add);
+
+			for (uint32_t i = 1; i < steps; ++i) {
+				it->Next(add);
+			}
+
+			it->Rest(add);
+			out += "|";
+		}
+	}
+}
+
+static std::string SplitAll(const std::vector<std::string> &strs)
+{
+	std::string out;
+
+	for (auto &str : strs) {
+		CConstStringPtr s(CStringPtr(str.data(), (uint32_t)str.size()));
+
+		Walk(out, [&s]() { return s->Split(CStringRef(",")); });
+		Walk(out, [&s]() { return s->Split(CStringRef(", ")); });
+		Walk(out, [&s]() { return s->Split(CStringRef("ab")); });
+		Walk(out, [&s]() { return s->SplitByToken(); });
+		Walk(out, [&s]() { return s->SplitByLine(); });
+		out += "\n";
+	}
+
+	return out;
+}
+
+static std::string Join(const CString::IteratorPtr &it)
+{
+	std::string out;
+
+	it->ForEach([&out](const CConstStringPtr &str) {
+		out += "[" + ToString(str) + "]";
+	});
+
+	return out;
+}
+
+template <class Mk>
+static double Bench(CStringSearch::Level level, uint32_t size, const Mk &mk)
+{
+	uint64_t best = ~0ULL;
+
+	CStringSearch::SetLevel(level);
+
+	for (uint32_t i = 0; i < BENCH_RUNS; ++i) {
+		uint64_t start = TestNow();
+
+		mk()->ForEach([](const CConstStringPtr &) {});
+		best = std::min(best, TestNow() - start);
+	}
+
+	return (double)size / best;
+}
+
+/* The scalar loops against the widest kernels on this CPU */
+template <class Mk>
+static void Bench(const char *name, uint32_t size, const Mk &mk)
+{
+	double scalar = Bench(CStringSearch::SCALAR, size, mk);
+	double vector = Bench(CStringSearch::AVX2, size, mk);
+
+	printf("%-10s scalar %6.2f GB/s, vector %6.2f GB/s\n", name, scalar, vector);
+}
+
+int main(void)
+{
+	std::mt19937 rng(7);
+	const char alpha[] = "ab ,\t\r\n";
+
+	TEST_CHECK("[a][b][][c]" == Join(CStringPtr("a,b,,c")->Split(CStringRef(","))));
+	TEST_CHECK("[c][][b][a]" == Join(CStringPtr("a,b,,c")->Split(CStringRef(","))->Reverse()));
+	TEST_CHECK("[x][y][][z]" == Join(CStringPtr("x::y::::z")->Split(CStringRef("::"))));
+	TEST_CHECK("[one][two][three]" == Join(CStringPtr("  one two\tthree  ")->SplitByToken()));
+	TEST_CHECK("[l1][l2][][l3]" == Join(CStringPtr("l1\r\nl2\n\nl3")->SplitByLine()));
+	TEST_CHECK("[l3][][l2][l1]" == Join(CStringPtr("l1\r\nl2\n\nl3")->SplitByLine()->Reverse()));
+
+	std::vector<std::string> strs;
+
+	for (uint32_t i = 0; i < SPLITS; ++i) {
+		std::string str((0 == i % 10) ? rng() % 300 : rng() % 40, 'a');
+
+		for (auto &c : str) {
+			c = alpha[rng() % 7];
+		}
+
+		strs.push_back(str);
+	}
+
+	for (auto &str : strs) {
+		CConstStringPtr s(CStringPtr(str.data(), (uint32_t)str.size()));
+
+		for (const char *key : {",", ", ", "ab"}) {
+			auto ref = RefSplit(str, key);
+			auto rev = Reversed(ref);
+
+			/* The string split in reverse keeps a string
+			 * shorter than the key whole, even an empty one */
+			if (1 < strlen(key) && str.size() < strlen(key)) {
+				rev.push_back(str);
+			}
+
+			TEST_CHECK(ref == Pieces(s->Split(CStringRef(key))));
+			TEST_CHECK(rev == Pieces(s->Split(CStringRef(key))->Reverse()));
+		}
+
+		TEST_CHECK(RefToken(str) == Pieces(s->SplitByToken()));
+		TEST_CHECK(Reversed(RefToken(str)) == Pieces(s->SplitByToken()->Reverse()));
+		TEST_CHECK(RefLine(str) == Pieces(s->SplitByLine()));
+	}
+
+	std::string scalar;
+
+	for (uint32_t level = CStringSearch::SCALAR; level <= CStringSearch::AVX2; ++level) {
+		CStringSearch::SetLevel((CStringSearch::Level)level);
+
+		/* Lowered on this CPU */
+		if (level != CStringSearch::GetLevel()) {
+			continue;
+		}
+
+		for (uint32_t i = 0; i < FUZZ; ++i) {
+			std::string buf(rng() % 100, 'a');
+			char set[4];
+			uint32_t nset = 1 + rng() % 4;
+
+			for (auto &c : buf) {
+				c = 'a' + rng() % 6;
+			}
+
+			for (auto &c : set) {
+				c = 'a' + rng() % 6;
+			}
+
+			const char *b = buf.data();
+			uint32_t size = buf.size();
+
+			TEST_CHECK(FindAny(b, size, set, nset, true, false) ==
+					   CStringSearch::FindAny(b, size, set, nset));
+			TEST_CHECK(FindAny(b, size, set, nset, true, true) ==
+					   CStringSearch::FindAnyRev(b, size, set, nset));
+			TEST_CHECK(FindAny(b, size, set, nset, false, false) ==
+					   CStringSearch::SkipAny(b, size, set, nset));
+			TEST_CHECK(FindAny(b, size, set, nset, false, true) ==
+					   CStringSearch::SkipAnyRev(b, size, set, nset));
+		}
+
+		std::string out = SplitAll(strs);
+
+		if (CStringSearch::SCALAR == level) {
+			scalar = out;
+		}
+
+		TEST_CHECK(scalar == out);
+	}
+
+	const char *words[] = {
+		"GET", "/index.html", "200", "user=alice", "ts=1700000000",
+		"latency_ms=12", "region=us-east-1", "agent=Mozilla/5.0",
+	};
+	std::string txt;
+
+	while (txt.size() < BENCH_SIZE) {
+		uint32_t cnt = 6 + rng() % 6;
+
+		for (uint32_t i = 0; i < cnt; ++i) {
+			txt += (0 == i) ? "" : (i % 3) ? ", " : " ";
+			txt += words[rng() % 8];
+		}
+
+		txt += "\n";
+	}
+
+	CStringPtr s(txt.data(), (uint32_t)txt.size());
+	uint32_t size = txt.size();
+
+	Bench("line", size, [&s]() { return s->SplitByLine(); });
+	Bench("line-rev", size, [&s]() { return s->SplitByLine()->Reverse(); });
+	Bench("char", size, [&s]() { return s->Split(CStringRef("\n")); });
+	Bench("str", size, [&s]() { return s->Split(CStringRef("ts=")); });
+	Bench("char-none", size, [&s]() { return s->Split(CStringRef("|")); });
+	Bench("str-none", size, [&s]() { return s->Split(CStringRef("||")); });
+	Bench("token", size, [&s]() { return s->SplitByToken(); });
+
+	return 0;
+}
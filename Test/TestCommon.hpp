@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2018 Guo Xiang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TEST_COMMON_HPP__
+#define __TEST_COMMON_HPP__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+/* A failed check is printed and the test exits with 1 */
+#define TEST_CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			exit(1); \
+		} \
+	} while (0)
+
+/* Nanoseconds of a monotonic clock */
+static inline uint64_t TestNow(void)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* The threads of a stress or a scaling run: one per CPU,
+ * but at least 4 so that they interleave on a single CPU. */
+static inline uint32_t TestThreads(void)
+{
+	uint32_t cpus = std::thread::hardware_concurrency();
+
+	return (cpus < 4) ? 4 : (cpus > 16) ? 16 : cpus;
+}
+
+/* Run fn(idx) on cnt threads and wait for all of them */
+template <class Fn>
+static inline void TestRun(uint32_t cnt, const Fn &fn)
+{
+	std::vector<std::thread> threads;
+
+	for (uint32_t i = 0; i < cnt; ++i) {
+		threads.emplace_back(fn, i);
+	}
+
+	for (auto &thread : threads) {
+		thread.join();
+	}
+}
+
+#endif /* __TEST_COMMON_HPP__ */